@@ -6,10 +6,22 @@ in vec2 fTexCoord;
 
 out vec4 FragColor;
 
-layout(location = 4) uniform mat4 WaterMapProjectionMatrix;
-layout(location = 5) uniform mat4 WaterMapViewMatrix;
 layout(location = 6) uniform float TextureScale;
-layout(location = 7) uniform float Time;
+
+// per frame (src/frame_uniforms.h), has to match in every shader that declares it
+layout(std140, binding = 0) uniform FrameUniforms {
+	mat4  View;
+	mat4  Projection;
+	mat4  ProjView;
+	mat4  InverseProjView;
+	mat4  TopView;            // the camera of the water-map & top-view passes
+	mat4  TopProjection;
+	mat4  TopProjView;
+	mat4  InverseTopProjView;
+	vec2  FramebufferSize;
+	float Time;
+	float DeltaTime;
+};
 
 layout(binding = 0) uniform sampler2D WaterMapDepth;
 layout(binding = 1) uniform sampler2D WaterMapNormals;
@@ -36,8 +48,7 @@ vec3 positionFromDepth(vec2 texCoord, sampler2D depthTexture, mat4 inverseViewPr
 
 vec3 getWaterWorldPosition(vec2 texCoord)
 {
-	mat4 inverseViewProjection = inverse(WaterMapProjectionMatrix * WaterMapViewMatrix);
-	return positionFromDepth(texCoord, WaterMapDepth, inverseViewProjection);
+	return positionFromDepth(texCoord, WaterMapDepth, InverseTopProjView);
 }
 
 vec3 decodeNormal(vec4 normal)
@@ -48,7 +59,7 @@ vec3 decodeNormal(vec4 normal)
 void main()
 {
 	// Projection the world position onto the watermap
-	vec4 waterMapCoordinate = WaterMapProjectionMatrix * WaterMapViewMatrix * fWorldPosition;
+	vec4 waterMapCoordinate = TopProjView * fWorldPosition;
 	vec2 waterMapCoordinateWDiv = waterMapCoordinate.xy / waterMapCoordinate.w;
 	vec2 normalizedWaterMapCoordinate = (waterMapCoordinateWDiv + vec2(1.0)) * 0.5;	
 	vec3 waterWorldPosition = getWaterWorldPosition(normalizedWaterMapCoordinate);
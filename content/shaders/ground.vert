@@ -9,13 +9,104 @@ out vec3 fNormal;
 out vec2 fTexCoord;
 
 layout(location = 0) uniform vec4 world_position;
-layout(location = 1) uniform mat4 proj_view;
 layout(location = 3) uniform mat3 NormalMatrix;
 
+// per pass (src/frame_uniforms.h), has to match in every shader that declares it
+layout(std140, binding = 1) uniform PassUniforms {
+	mat4 PassProjView; // what the pass renders from
+};
+
+// clipmap levels (src/clipmap.h), has to match in ground.vert, water.vert & simplewater.vert.
+// with ClipmapResolution at 0 the whole mesh comes in through the vertex attributes instead
+layout(location = 10) uniform int   ClipmapResolution;   // cells per side of a level
+layout(location = 11) uniform ivec2 ClipmapOrigin;       // cell of the first vertex of the level
+layout(location = 12) uniform int   ClipmapStride;       // cells between its vertices
+layout(location = 13) uniform vec2  ClipmapCenter;       // in cells
+layout(location = 14) uniform vec2  ClipmapMorph;        // distance from the center in strides where heights blend into the next level
+layout(location = 15) uniform int   ClipmapFormat;       // of HeightBuffer : 0 vec4 positions, 1 vec2 state, 2 packed half state
+layout(location = 16) uniform int   ClipmapDisplacement; // 1 when DisplacementBuffer is bound
+layout(location = 17) uniform int   ClipmapDimension;    // mesh_size + 1
+
+layout(std430, binding = 0) readonly buffer HeightBuffer {
+	uint heights[];
+};
+
+layout(std430, binding = 1) readonly buffer NormalBuffer {
+	vec4 normals[];
+};
+
+layout(std430, binding = 2) readonly buffer DisplacementBuffer {
+	vec2 displacements[];
+};
+
+struct ClipmapSample {
+	vec2 state; // (height, velocity), velocity is 0 for static meshes
+	vec3 normal;
+	vec2 displacement;
+};
+
+ClipmapSample clipmapSample(ivec2 cell) {
+	// x/z of the mesh are y/x of the grid, see create_mesh()
+	cell = clamp(cell, ivec2(0), ivec2(ClipmapDimension - 1));
+	uint index = uint(cell.x * ClipmapDimension + cell.y);
+
+	ClipmapSample s;
+	if      (ClipmapFormat == 2) s.state = unpackHalf2x16(heights[index]);
+	else if (ClipmapFormat == 1) s.state = uintBitsToFloat(uvec2(heights[2 * index], heights[2 * index + 1]));
+	else                         s.state = vec2(uintBitsToFloat(heights[4 * index + 1]), 0.0);
+
+	s.normal       = normals[index].xyz;
+	s.displacement = ClipmapDisplacement != 0 ? displacements[index] : vec2(0.0);
+	return s;
+}
+
+// the vertex of the level & the cell it sits on. odd vertices blend towards the middle of the edge of the next
+// level they lie on (the diagonal when both are odd), fully by the outer edge so it matches the next level there
+ClipmapSample clipmapVertex(out vec2 cell) {
+	int vertices = ClipmapResolution + 1;
+	ivec2 vertex   = ivec2(gl_VertexID / vertices, gl_VertexID % vertices);
+	ivec2 location = ClipmapOrigin + vertex * ClipmapStride;
+
+	ClipmapSample s = clipmapSample(location);
+
+	ivec2 odd = vertex & 1;
+	if (odd != ivec2(0))
+	{
+		ivec2 along = odd * ClipmapStride;
+		ClipmapSample a = clipmapSample(location - along);
+		ClipmapSample b = clipmapSample(location + along);
+
+		vec2 offset = abs(vec2(location) - ClipmapCenter) / float(ClipmapStride);
+		float morph = clamp((max(offset.x, offset.y) - ClipmapMorph.x) / (ClipmapMorph.y - ClipmapMorph.x), 0.0, 1.0);
+
+		s.state        = mix(s.state       , 0.5 * (a.state        + b.state       ), morph);
+		s.normal       = mix(s.normal      , 0.5 * (a.normal       + b.normal      ), morph);
+		s.displacement = mix(s.displacement, 0.5 * (a.displacement + b.displacement), morph);
+	}
+
+	cell = vec2(clamp(location, ivec2(0), ivec2(ClipmapDimension - 1)));
+	s.normal = normalize(s.normal);
+	return s;
+}
+
 void main()
 {
-	fTexCoord = TexCoord;
-	fNormal   = NormalMatrix * Normal;
-	fWorldPosition = world_position + Position;
-	gl_Position = proj_view * fWorldPosition;
-}
\ No newline at end of file
+	if (ClipmapResolution > 0)
+	{
+		vec2 cell;
+		ClipmapSample s = clipmapVertex(cell);
+		vec2 position = cell / float(ClipmapDimension - 1);
+
+		fTexCoord = position;
+		fNormal   = NormalMatrix * s.normal;
+		fWorldPosition = world_position + vec4(position.x, s.state.x, position.y, 1.0);
+	}
+	else
+	{
+		fTexCoord = TexCoord;
+		fNormal   = NormalMatrix * Normal;
+		fWorldPosition = world_position + Position;
+	}
+
+	gl_Position = PassProjView * fWorldPosition;
+}
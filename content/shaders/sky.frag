@@ -4,7 +4,20 @@ in vec4 tex;
 
 out vec4 FragColor;
 
-layout(location = 1) uniform mat4 inverse_view_proj;
+// per frame (src/frame_uniforms.h), has to match in every shader that declares it
+layout(std140, binding = 0) uniform FrameUniforms {
+	mat4  View;
+	mat4  Projection;
+	mat4  ProjView;
+	mat4  InverseProjView;
+	mat4  TopView;            // the camera of the water-map & top-view passes
+	mat4  TopProjection;
+	mat4  TopProjView;
+	mat4  InverseTopProjView;
+	vec2  FramebufferSize;
+	float Time;
+	float DeltaTime;
+};
 
 layout(binding = 0) uniform samplerCube sky_cubemap;
 
@@ -15,8 +28,8 @@ void main()
 	vec4 view_back  = vec4(tex.xy * 2.0 - 1.0,  1.0, 1.0);
 	
 	// convert to world coordinates
-	view_front = inverse_view_proj * view_front;
-	view_back  = inverse_view_proj * view_back;
+	view_front = InverseProjView * view_front;
+	view_back  = InverseProjView * view_back;
 	
 	// not sure what this is
 	vec3 front = view_front.xyz / view_front.w;
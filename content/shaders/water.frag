@@ -8,14 +8,20 @@ in float fVelocity;
 
 out vec4 FragColor;
 
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
-
-layout(location = 4) uniform vec2 FramebufferSize;
-layout(location = 5) uniform mat4 TopViewMatrix;
-layout(location = 6) uniform mat4 TopProjectionMatrix;
-layout(location = 7) uniform float DeltaTime;
-layout(location = 8) uniform float Time;
+// per frame (src/frame_uniforms.h), has to match in every shader that declares it
+layout(std140, binding = 0) uniform FrameUniforms {
+	mat4  View;
+	mat4  Projection;
+	mat4  ProjView;
+	mat4  InverseProjView;
+	mat4  TopView;            // the camera of the water-map & top-view passes
+	mat4  TopProjection;
+	mat4  TopProjView;
+	mat4  InverseTopProjView;
+	vec2  FramebufferSize;
+	float Time;
+	float DeltaTime;
+};
 
 layout(binding = 0) uniform sampler2D BackgroundColorTexture;
 layout(binding = 1) uniform sampler2D BackgroundDepthTexture;
@@ -49,16 +55,14 @@ float getBackgroundDepth(vec2 coordinate) {
 }
 
 vec3 getTopWorldPosition(vec4 worldPosition) {
-	vec4 dc = TopProjectionMatrix * TopViewMatrix * worldPosition;
+	vec4 dc = TopProjView * worldPosition;
 	vec3 ndc = dc.xyz / dc.w;
 	vec2 coordinate = (ndc.xy + 1.0) / 2.0;
-	mat4 inverseViewProjection = inverse(TopProjectionMatrix * TopViewMatrix);
-	return positionFromDepth(coordinate, TopViewDepthTexture, inverseViewProjection);
+	return positionFromDepth(coordinate, TopViewDepthTexture, InverseTopProjView);
 }
 
 vec3 getBackgroundWorldPosition(vec2 texCoord) {
-	mat4 inverseViewProjection = inverse(ProjectionMatrix * ViewMatrix);
-	return positionFromDepth(texCoord, BackgroundDepthTexture, inverseViewProjection);
+	return positionFromDepth(texCoord, BackgroundDepthTexture, InverseProjView);
 }
 
 void main() {
@@ -90,9 +94,8 @@ void main() {
 	vec4 subsurfaceLight = SCATTERING_INTENSITY * lightScattering;
 	
 	// Eye vector
-	mat4 inverseViewProjection = inverse(ProjectionMatrix * ViewMatrix);
-	vec4 eyeVectorFront = inverseViewProjection * vec4(fNdc.x, fNdc.y, -1, 1);
-	vec4 eyeVectorBack  = inverseViewProjection * vec4(fNdc.x, fNdc.y,  1, 1);	
+	vec4 eyeVectorFront = InverseProjView * vec4(fNdc.x, fNdc.y, -1, 1);
+	vec4 eyeVectorBack  = InverseProjView * vec4(fNdc.x, fNdc.y,  1, 1);	
 	vec3 eyeVectorFrontWDiv = eyeVectorFront.xyz / eyeVectorFront.w;
 	vec3 eyeVectorBackWDiv  = eyeVectorBack.xyz / eyeVectorBack.w;	
 	vec3 eyeVector = normalize(eyeVectorFrontWDiv - eyeVectorBackWDiv);	
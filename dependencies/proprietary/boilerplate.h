@@ -39,7 +39,7 @@ struct bvec3 { union { struct { byte x, y, z; }; struct { byte r, g, b; }; }; };
 byte* read_text_file_into_memory(const char* path)
 {
 	DWORD BytesRead;
-	HANDLE os_file = CreateFile(path, GENERIC_READ | GENERIC_WRITE, NULL, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	HANDLE os_file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
 
 	LARGE_INTEGER size;
 	GetFileSizeEx(os_file, &size);
@@ -54,13 +54,13 @@ byte* read_text_file_into_memory(const char* path)
 void load_file_r32(const char* path, float* memory, uint n)
 {
 	DWORD BytesRead;
-	HANDLE os_file = CreateFile(path, GENERIC_READ, NULL, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	HANDLE os_file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
 	ReadFile(os_file, (byte*)memory, n * n * sizeof(float), &BytesRead, NULL);
 	CloseHandle(os_file);
 }
 
 // ------------------------------------------------- //
-// --------------------- Timers -------------------- // // might be broken idk
+// --------------------- Timers -------------------- // // profiler.h has a portable clock & scoped zones
 // ------------------------------------------------- //
 
 // while the raw timestamp can be used for relative performence measurements,
@@ -89,8 +89,8 @@ int64 calculate_microseconds_elapsed(Timestamp start, Timestamp end)
 	LARGE_INTEGER win32_performance_frequency;
 	QueryPerformanceFrequency(&win32_performance_frequency);
 
-	// i think (end - start) corresponds directly to cpu clock cycles but i'm not sure
-	return (1000000 * end - start) / win32_performance_frequency.QuadPart;
+	// (end - start) is in ticks of the performance counter, not cpu cycles
+	return (1000000 * (end - start)) / win32_performance_frequency.QuadPart;
 }
 
 void os_sleep(uint milliseconds)
@@ -158,6 +158,10 @@ void play_audio(Audio source_id)
 // ----------------- Multithreading ---------------- //
 // ------------------------------------------------- //
 
+// Thread_Pool & parallel_for() live in here, use them for anything that has to finish
+#include <proprietary/threads.h>
+
+// fire & forget, nothing waits for these
 typedef DWORD WINAPI thread_function(LPVOID); // what is this sorcery?
 DWORD WINAPI thread_func(LPVOID param)
 {
@@ -0,0 +1,501 @@
+// plan based fft : bit reversal & twiddles are worked out once per size instead of on every call
+// same conventions as fft() / ifft() in mathematics.h : forward is e^(-i), ifft scales by 1 / N
+// expects Complex, uint, Alloc & print to be defined (mathematics.h & boilerplate.h)
+
+#pragma once
+
+#include <chrono>
+#include <proprietary/threads.h> // rows of 2D transforms are spread across a Thread_Pool
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define FFT_SIMD_WIDTH 2 // complex doubles per register
+#else
+	#define FFT_SIMD_WIDTH 1
+#endif
+
+// PI is a float, the twiddles want every digit
+#define FFT_PI 3.14159265358979323846
+
+/* -- how 2 use fft plans --
+
+	FFT_Plan plan = {};
+	init(&plan, 256);               // N has to be a power of 2
+	fft  (&plan, data);             // same as fft(data, 256)
+	ifft (&plan, data);             // same as ifft(data, 256)
+	fft2D(&plan, grid);             // 256 x 256, nothing gets allocated
+	fft2D(&plan, grid, &pool);      // same, rows spread across the pool
+	fft_batch(&plan, rows, 64);     // 64 arrays of 256 one after the other
+	free(&plan);
+
+	FFT_Real_Plan real = {};        // height fields : N real samples <-> N / 2 + 1 bins
+	init(&real, 256);
+	fft_real   (&real, heights, spectrum);
+	ifft2D_real(&real, spectrum, heights); // 256 x 129 bins -> 256 x 256 heights
+	free(&real);
+*/
+
+struct FFT_Plan
+{
+	uint N, log2_N;
+	uint* bit_reverse;         // [N]
+	Complex* twiddles;         // [N - 1], the pass with half size m uses e^(-i pi j / m), j < m, starting at [m - 1]
+	Complex* inverse_twiddles; // [N - 1], conjugates
+	Complex* scratch;          // [N], columns in fft_columns()
+};
+
+void init(FFT_Plan* plan, uint N)
+{
+	plan->N = N;
+	plan->log2_N = 0;
+	while ((1u << plan->log2_N) < N) plan->log2_N++;
+
+	plan->bit_reverse = Alloc(uint, N);
+	for (uint i = 0; i < N; i++)
+	{
+		uint reversed = 0;
+		for (uint bit = 0; bit < plan->log2_N; bit++) reversed |= ((i >> bit) & 1) << (plan->log2_N - 1 - bit);
+		plan->bit_reverse[i] = reversed;
+	}
+
+	plan->twiddles         = Alloc(Complex, N);
+	plan->inverse_twiddles = Alloc(Complex, N);
+	for (uint m = 1; m < N; m <<= 1) {
+	for (uint j = 0; j < m; j++)
+	{
+		double angle = -FFT_PI * j / m; // straight from sin & cos, a recurrence drifts
+		plan->twiddles        [m - 1 + j] = Complex(cos(angle),  sin(angle));
+		plan->inverse_twiddles[m - 1 + j] = Complex(cos(angle), -sin(angle));
+	} }
+
+	plan->scratch = Alloc(Complex, N);
+}
+void free(FFT_Plan* plan)
+{
+	free(plan->bit_reverse);
+	free(plan->twiddles);
+	free(plan->inverse_twiddles);
+	free(plan->scratch);
+	*plan = {};
+}
+
+// -- butterflies -- //
+
+// * -i for the forward transform, * i for the inverse
+Complex fft_rotate(Complex z, bool inverse)
+{
+	return inverse ? Complex(-z.imag(), z.real()) : Complex(z.imag(), -z.real());
+}
+
+#if FFT_SIMD_WIDTH == 2
+// two complex products at once, register = (re0, im0, re1, im1)
+__m256d fft_mul(__m256d a, __m256d w)
+{
+	__m256d w_real  = _mm256_movedup_pd(w);        // (wr0, wr0, wr1, wr1)
+	__m256d w_imag  = _mm256_permute_pd(w, 0xF);   // (wi0, wi0, wi1, wi1)
+	__m256d swapped = _mm256_permute_pd(a, 0x5);   // (ai0, ar0, ai1, ar1)
+	return _mm256_addsub_pd(_mm256_mul_pd(a, w_real), _mm256_mul_pd(swapped, w_imag));
+}
+__m256d fft_rotate(__m256d z, bool inverse)
+{
+	__m256d swapped = _mm256_permute_pd(z, 0x5); // (im, re)
+	__m256d sign = inverse ? _mm256_set_pd(0.0, -0.0, 0.0, -0.0) : _mm256_set_pd(-0.0, 0.0, -0.0, 0.0);
+	return _mm256_xor_pd(swapped, sign);
+}
+#endif
+
+// one radix-2 pass over blocks of 2m, w = twiddles for half size m
+void fft_radix2_pass(Complex* data, uint N, uint m, const Complex* w)
+{
+	for (uint k = 0; k < N; k += 2 * m)
+	{
+		uint j = 0;
+
+	#if FFT_SIMD_WIDTH == 2
+		for (; j + 2 <= m; j += 2)
+		{
+			double* a = (double*)(data + k + j);
+			double* b = (double*)(data + k + j + m);
+
+			__m256d t  = fft_mul(_mm256_loadu_pd(b), _mm256_loadu_pd((const double*)(w + j)));
+			__m256d a0 = _mm256_loadu_pd(a);
+			_mm256_storeu_pd(b, _mm256_sub_pd(a0, t));
+			_mm256_storeu_pd(a, _mm256_add_pd(a0, t));
+		}
+	#endif
+
+		for (; j < m; j++)
+		{
+			Complex t = data[k + j + m] * w[j];
+			data[k + j + m] = data[k + j] - t;
+			data[k + j]    += t;
+		}
+	}
+}
+
+// two radix-2 passes (half size m & 2m) fused into one radix-4 pass over blocks of 4m,
+// so every element is loaded & stored once per 2 bits of N. w1 = twiddles for m, w2 for 2m
+void fft_radix4_pass(Complex* data, uint N, uint m, const Complex* w1, const Complex* w2, bool inverse)
+{
+	for (uint k = 0; k < N; k += 4 * m)
+	{
+		uint j = 0;
+
+	#if FFT_SIMD_WIDTH == 2
+		for (; j + 2 <= m; j += 2)
+		{
+			double* p0 = (double*)(data + k + j);
+			double* p1 = (double*)(data + k + j + m);
+			double* p2 = (double*)(data + k + j + 2 * m);
+			double* p3 = (double*)(data + k + j + 3 * m);
+
+			__m256d t1 = _mm256_loadu_pd((const double*)(w1 + j));
+			__m256d t2 = _mm256_loadu_pd((const double*)(w2 + j));
+
+			__m256d a0 = _mm256_loadu_pd(p0);
+			__m256d a1 = fft_mul(_mm256_loadu_pd(p1), t1);
+			__m256d a2 = _mm256_loadu_pd(p2);
+			__m256d a3 = fft_mul(_mm256_loadu_pd(p3), t1);
+
+			__m256d b0 = _mm256_add_pd(a0, a1);
+			__m256d b1 = _mm256_sub_pd(a0, a1);
+			__m256d b2 = fft_mul(_mm256_add_pd(a2, a3), t2);
+			__m256d b3 = fft_rotate(fft_mul(_mm256_sub_pd(a2, a3), t2), inverse);
+
+			_mm256_storeu_pd(p0, _mm256_add_pd(b0, b2));
+			_mm256_storeu_pd(p2, _mm256_sub_pd(b0, b2));
+			_mm256_storeu_pd(p1, _mm256_add_pd(b1, b3));
+			_mm256_storeu_pd(p3, _mm256_sub_pd(b1, b3));
+		}
+	#endif
+
+		for (; j < m; j++)
+		{
+			Complex a0 = data[k + j];
+			Complex a1 = data[k + j + m] * w1[j];
+			Complex a2 = data[k + j + 2 * m];
+			Complex a3 = data[k + j + 3 * m] * w1[j];
+
+			Complex b0 = a0 + a1;
+			Complex b1 = a0 - a1;
+			Complex b2 = (a2 + a3) * w2[j];
+			Complex b3 = fft_rotate((a2 - a3) * w2[j], inverse); // e^(-i pi (j + m) / 2m) = w2 * -i
+
+			data[k + j        ] = b0 + b2;
+			data[k + j + 2 * m] = b0 - b2;
+			data[k + j +     m] = b1 + b3;
+			data[k + j + 3 * m] = b1 - b3;
+		}
+	}
+}
+
+// unscaled in place transform
+void fft_execute(FFT_Plan* plan, Complex* data, bool inverse)
+{
+	uint N = plan->N;
+
+	for (uint i = 0; i < N; i++)
+	{
+		uint target = plan->bit_reverse[i];
+		if (target > i) { Complex temp = data[target]; data[target] = data[i]; data[i] = temp; }
+	}
+
+	const Complex* w = inverse ? plan->inverse_twiddles : plan->twiddles;
+
+	uint m = 1;
+	if (plan->log2_N & 1) { fft_radix2_pass(data, N, 1, w); m = 2; } // odd number of bits left over
+
+	for (; m < N; m *= 4) fft_radix4_pass(data, N, m, w + m - 1, w + (2 * m) - 1, inverse);
+}
+
+// -- complex transforms -- //
+
+void fft(FFT_Plan* plan, Complex* input)
+{
+	fft_execute(plan, input, false);
+}
+void ifft(FFT_Plan* plan, Complex* input, bool scale = true)
+{
+	fft_execute(plan, input, true);
+	if (scale) for (uint i = 0; i < plan->N; i++) input[i] *= 1.0 / plan->N;
+}
+
+// count transforms of plan->N, distance apart (0 = packed)
+void fft_batch(FFT_Plan* plan, Complex* input, uint count, uint distance = 0)
+{
+	if (!distance) distance = plan->N;
+	for (uint i = 0; i < count; i++) fft(plan, input + (i * distance));
+}
+void ifft_batch(FFT_Plan* plan, Complex* input, uint count, uint distance = 0, bool scale = true)
+{
+	if (!distance) distance = plan->N;
+	for (uint i = 0; i < count; i++) ifft(plan, input + (i * distance), scale);
+}
+
+// -- 2D transforms -- //
+
+// square blocks that fit in L1 twice (16 x 16 x 16 bytes = 4kb), so a transpose never walks a column
+#define FFT_TRANSPOSE_BLOCK 16
+
+// transposes the blocks in one block row with their mirror images, diagonal blocks in place
+void fft_transpose_block_row(Complex* data, uint N, uint block_row)
+{
+	uint block = glm::min((uint)FFT_TRANSPOSE_BLOCK, N);
+	uint i0 = block_row * block;
+
+	for (uint j0 = i0; j0 < N; j0 += block) {
+	for (uint i = i0; i < i0 + block; i++)
+	{
+		uint j = (j0 == i0) ? i + 1 : j0; // diagonal blocks only swap their upper half
+		for (; j < j0 + block; j++)
+		{
+			Complex temp        = data[(i * N) + j];
+			data[(i * N) + j]   = data[(j * N) + i];
+			data[(j * N) + i]   = temp;
+		}
+	} }
+}
+
+struct FFT_2D_Job
+{
+	FFT_Plan* plan;
+	Complex* data;
+	bool inverse, scale;
+};
+
+void fft_row_job(uint row, uint thread_index, void* params)
+{
+	FFT_2D_Job* job = (FFT_2D_Job*)params;
+	Complex* data = job->data + (row * job->plan->N);
+
+	fft_execute(job->plan, data, job->inverse);
+	if (job->scale) for (uint i = 0; i < job->plan->N; i++) data[i] *= 1.0 / job->plan->N;
+}
+void fft_transpose_job(uint block_row, uint thread_index, void* params)
+{
+	FFT_2D_Job* job = (FFT_2D_Job*)params;
+	fft_transpose_block_row(job->data, job->plan->N, block_row);
+}
+
+// in place N x N : rows, transpose, rows (the old columns), transpose back. every pass is contiguous.
+// the plan is only read, so the pool can run rows in parallel. pool can be NULL
+void fft2D_execute(FFT_Plan* plan, Complex* data, bool inverse, bool scale, Thread_Pool* pool)
+{
+	uint N = plan->N;
+	uint num_block_rows = N / glm::min((uint)FFT_TRANSPOSE_BLOCK, N);
+
+	FFT_2D_Job job = { plan, data, inverse, scale };
+
+	for (uint pass = 0; pass < 2; pass++)
+	{
+		parallel_for(pool, N, fft_row_job, &job);
+		parallel_for(pool, num_block_rows, fft_transpose_job, &job); // triangular, so handed out dynamically
+	}
+}
+
+// num_columns of a grid with N rows, each column goes through the plan's scratch (non square grids)
+void fft_columns(FFT_Plan* plan, Complex* input, uint num_columns, uint row_size, bool inverse, bool scale)
+{
+	uint N = plan->N;
+	Complex* column = plan->scratch;
+
+	for (uint n = 0; n < num_columns; n++)
+	{
+		for (uint i = 0; i < N; i++) column[i] = input[(i * row_size) + n];
+
+		if (inverse) ifft(plan, column, scale);
+		else         fft (plan, column);
+
+		for (uint i = 0; i < N; i++) input[(i * row_size) + n] = column[i];
+	}
+}
+void fft2D(FFT_Plan* plan, Complex* input, Thread_Pool* pool = NULL)
+{
+	fft2D_execute(plan, input, false, false, pool);
+}
+void ifft2D(FFT_Plan* plan, Complex* input, bool scale = false, Thread_Pool* pool = NULL)
+{
+	fft2D_execute(plan, input, true, scale, pool);
+}
+
+// out of place versions, input is left alone
+void fft2D(FFT_Plan* plan, const Complex* input, Complex* output, Thread_Pool* pool = NULL)
+{
+	memcpy(output, input, sizeof(Complex) * plan->N * plan->N);
+	fft2D_execute(plan, output, false, false, pool);
+}
+void ifft2D(FFT_Plan* plan, const Complex* input, Complex* output, bool scale = false, Thread_Pool* pool = NULL)
+{
+	memcpy(output, input, sizeof(Complex) * plan->N * plan->N);
+	fft2D_execute(plan, output, true, scale, pool);
+}
+
+// -- real transforms -- //
+
+// N real samples are packed into N / 2 complex ones (even + i * odd) & split again after the transform
+struct FFT_Real_Plan
+{
+	uint N;
+	FFT_Plan half;     // N / 2, rows
+	FFT_Plan columns;  // N, columns of 2D transforms
+	Complex* twiddles; // [N / 2] e^(-2 pi i k / N)
+};
+
+void init(FFT_Real_Plan* plan, uint N)
+{
+	plan->N = N;
+	init(&plan->half   , N / 2);
+	init(&plan->columns, N);
+
+	plan->twiddles = Alloc(Complex, N / 2);
+	for (uint k = 0; k < N / 2; k++)
+	{
+		double angle = -2.0 * FFT_PI * k / N;
+		plan->twiddles[k] = Complex(cos(angle), sin(angle));
+	}
+}
+void free(FFT_Real_Plan* plan)
+{
+	free(&plan->half);
+	free(&plan->columns);
+	free(plan->twiddles);
+	*plan = {};
+}
+
+// N samples -> bins 0 .. N / 2, the rest are the conjugates of these
+void fft_real(FFT_Real_Plan* plan, const float* input, Complex* output)
+{
+	uint M = plan->N / 2;
+	Complex* z = plan->half.scratch;
+
+	for (uint n = 0; n < M; n++) z[n] = Complex(input[2 * n], input[(2 * n) + 1]);
+	fft_execute(&plan->half, z, false);
+
+	for (uint k = 0; k <= M; k++)
+	{
+		Complex zk = z[k % M];
+		Complex zc = conj(z[(M - k) % M]);
+
+		Complex even = (zk + zc) * 0.5;
+		Complex odd  = (zk - zc) * Complex(0, -0.5);
+		Complex w    = k < M ? plan->twiddles[k] : Complex(-1);
+
+		output[k] = even + (w * odd);
+	}
+}
+
+// bins 0 .. N / 2 -> N samples, scale like ifft()
+void ifft_real(FFT_Real_Plan* plan, const Complex* input, float* output, bool scale = true)
+{
+	uint M = plan->N / 2;
+	Complex* z = plan->half.scratch;
+
+	for (uint k = 0; k < M; k++)
+	{
+		Complex xk = input[k];
+		Complex xc = conj(input[M - k]);
+
+		Complex even = (xk + xc) * 0.5;
+		Complex odd  = (xk - xc) * conj(plan->twiddles[k]) * 0.5;
+
+		z[k] = even + Complex(-odd.imag(), odd.real()); // even + i * odd
+	}
+
+	fft_execute(&plan->half, z, true);
+
+	double factor = scale ? 1.0 / M : 2.0; // the half size transform leaves M * x, a full one N * x
+	for (uint n = 0; n < M; n++)
+	{
+		output[(2 * n)    ] = (float)(z[n].real() * factor);
+		output[(2 * n) + 1] = (float)(z[n].imag() * factor);
+	}
+}
+
+// count rows of N samples <-> count rows of N / 2 + 1 bins
+void fft_real_batch(FFT_Real_Plan* plan, const float* input, Complex* output, uint count)
+{
+	for (uint i = 0; i < count; i++) fft_real(plan, input + (i * plan->N), output + (i * (plan->N / 2 + 1)));
+}
+void ifft_real_batch(FFT_Real_Plan* plan, const Complex* input, float* output, uint count, bool scale = true)
+{
+	for (uint i = 0; i < count; i++) ifft_real(plan, input + (i * (plan->N / 2 + 1)), output + (i * plan->N), scale);
+}
+
+// N x N height field <-> N rows of N / 2 + 1 bins
+void fft2D_real(FFT_Real_Plan* plan, const float* input, Complex* output)
+{
+	fft_real_batch(plan, input, output, plan->N);
+	fft_columns(&plan->columns, output, plan->N / 2 + 1, plan->N / 2 + 1, false, false);
+}
+// the spectrum is used as scratch & gets overwritten
+void ifft2D_real(FFT_Real_Plan* plan, Complex* input, float* output, bool scale = false)
+{
+	fft_columns(&plan->columns, input, plan->N / 2 + 1, plan->N / 2 + 1, true, scale);
+	ifft_real_batch(plan, input, output, plan->N, scale);
+}
+
+// -- benchmarks -- //
+
+// microseconds per transform through the plan, N = min_N .. max_N, & how far a roundtrip lands from the input
+void fft_benchmark(uint min_N = 64, uint max_N = 4096, uint num_transforms = 2000)
+{
+	print("fft benchmark (%s)\n", FFT_SIMD_WIDTH > 1 ? "avx" : "scalar");
+
+	for (uint N = min_N; N <= max_N; N <<= 1)
+	{
+		Complex* source = Alloc(Complex, N);
+		Complex* data   = Alloc(Complex, N);
+
+		// the timings don't depend on the input
+		for (uint i = 0; i < N; i++) source[i] = Complex(rand() / (double)RAND_MAX, rand() / (double)RAND_MAX);
+
+		FFT_Plan plan = {};
+		init(&plan, N);
+
+		// every transform starts from the same input so the numbers don't blow up
+		auto start = std::chrono::steady_clock::now();
+		for (uint i = 0; i < num_transforms; i++) { memcpy(data, source, sizeof(Complex) * N); fft(&plan, data); }
+		auto end = std::chrono::steady_clock::now();
+
+		double microseconds = std::chrono::duration<double, std::micro>(end - start).count() / num_transforms;
+
+		double error = 0;
+		ifft(&plan, data);
+		for (uint i = 0; i < N; i++) error = glm::max(error, abs(data[i] - source[i]));
+
+		print("fft %4u : %9.3f us | roundtrip error %.1e\n", N, microseconds, error);
+
+		free(&plan);
+		free(source);
+		free(data);
+	}
+}
+
+// milliseconds per N x N ifft2D, columns gathered through the plan's scratch vs blocked transposes on the pool
+void fft2D_benchmark(uint N = 1024, Thread_Pool* pool = NULL, uint num_transforms = 10)
+{
+	Complex* data = Alloc(Complex, N * N);
+	for (uint i = 0; i < N * N; i++) data[i] = Complex(rand() / (double)RAND_MAX, rand() / (double)RAND_MAX);
+
+	FFT_Plan plan = {};
+	init(&plan, N);
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint i = 0; i < num_transforms; i++)
+	{
+		for (uint row = 0; row < N; row++) ifft(&plan, data + (row * N), false);
+		fft_columns(&plan, data, N, N, true, false);
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (uint i = 0; i < num_transforms; i++) ifft2D(&plan, data, false, pool);
+	auto end = std::chrono::steady_clock::now();
+
+	double gathered_ms = std::chrono::duration<double, std::milli>(middle - start).count() / num_transforms;
+	double blocked_ms  = std::chrono::duration<double, std::milli>(end - middle).count() / num_transforms;
+
+	print("ifft2D %u^2 : %.2f ms -> %.2f ms on %u threads (x%.2f)\n",
+		N, gathered_ms, blocked_ms, pool ? pool->num_threads : 1, gathered_ms / blocked_ms);
+
+	free(&plan);
+	free(data);
+}
@@ -527,6 +527,9 @@ void ifft2D(Complex* input, uint N, bool scale = false)
 	free(subarray);
 }
 
+// same transforms with cached bit reversal & twiddles, no allocation per call & real <-> complex
+#include <proprietary/fft.h>
+
 void save_fft2D(Complex* data, uint N, const char* name = "fft2D.bmp")
 {
 	bvec3* bitmap = (bvec3*)calloc(N * N, 3); // 3 bytes per channel
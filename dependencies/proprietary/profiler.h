@@ -0,0 +1,204 @@
+// scoped cpu profiler, dumps chrome trace json (chrome://tracing or ui.perfetto.dev)
+// expects uint to be defined (mathematics.h or window.h)
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// ------------------------------------------------- //
+// -------------------- Profiling ------------------ //
+// ------------------------------------------------- //
+
+/* -- how 2 profile --
+
+	profiler_start(); // zones cost a single check until this runs
+
+	void update()
+	{
+		PROFILE_SCOPE("update"); // from here to the end of the block
+		...
+	}
+
+	Profile_Zone zone("render"); // or ended by hand
+	...
+	end(zone);
+
+	profiler_write_trace("trace.json"); // while nothing is running, or the newest zones may be half written
+*/
+
+#define PROFILER_MAX_THREADS 64
+#define PROFILER_RING_SIZE   (1 << 16) // zones kept per thread, has to be a power of 2
+
+struct Profile_Event
+{
+	const char* name; // has to outlive the profiler, string literals
+	uint64_t begin, end; // ns
+};
+
+// only its own thread writes to it, so recording needs no locks. a thread that exits gives it back,
+// the next one carries on in the same ring
+struct Profiler_Thread
+{
+	Profile_Event* events; // the last PROFILER_RING_SIZE zones
+	std::atomic<uint64_t> count; // zones ever recorded
+	std::atomic<bool> used; // by a running thread
+	const char* name;
+	uint id;
+};
+
+struct Profiler
+{
+	Profiler_Thread threads[PROFILER_MAX_THREADS];
+	std::atomic<uint> num_threads; // slots ever used
+	std::atomic<bool> enabled;
+	uint64_t start; // ns, the trace starts here
+};
+
+static Profiler global_profiler;
+
+// monotonic, unlike the wall clock it never jumps
+uint64_t profiler_now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// what a thread holds, its slot goes back to the profiler when the thread exits
+struct Profiler_Thread_Slot
+{
+	Profiler_Thread* thread; // NULL until it records something
+	const char* name;
+
+	~Profiler_Thread_Slot()
+	{
+		if (thread) thread->used.store(false, std::memory_order_release);
+	}
+};
+
+static thread_local Profiler_Thread_Slot profiler_slot;
+
+// the ring of the calling thread, it gets a free slot the first time it records anything. NULL when all are taken
+Profiler_Thread* profiler_thread()
+{
+	Profiler_Thread_Slot& slot = profiler_slot;
+	for (uint id = 0; id < PROFILER_MAX_THREADS && !slot.thread; id++)
+	{
+		Profiler_Thread& thread = global_profiler.threads[id];
+
+		bool used = false;
+		if (!thread.used.compare_exchange_strong(used, true)) continue;
+
+		// allocated once per slot, a reused slot keeps the ring & the zones of the threads before
+		if (!thread.events) thread.events = (Profile_Event*)calloc(PROFILER_RING_SIZE, sizeof(Profile_Event));
+		thread.name = slot.name;
+		thread.id   = id;
+		slot.thread = &thread;
+
+		uint num_threads = global_profiler.num_threads;
+		while (num_threads < id + 1 && !global_profiler.num_threads.compare_exchange_weak(num_threads, id + 1));
+	}
+
+	return slot.thread;
+}
+
+// costs nothing until the thread records a zone, so it can be called whether or not the profiler runs
+void profiler_set_thread_name(const char* name)
+{
+	profiler_slot.name = name;
+	if (profiler_slot.thread) profiler_slot.thread->name = name;
+}
+
+void profiler_start()
+{
+	global_profiler.start = profiler_now();
+	global_profiler.enabled = true;
+}
+void profiler_stop()
+{
+	global_profiler.enabled = false;
+}
+
+void profiler_record(const char* name, uint64_t begin, uint64_t end)
+{
+	Profiler_Thread* thread = profiler_thread();
+	if (!thread) return;
+
+	// the count is published after the event, so a reader never sees it before it is written
+	uint64_t i = thread->count.load(std::memory_order_relaxed);
+	thread->events[i & (PROFILER_RING_SIZE - 1)] = { name, begin, end };
+	thread->count.store(i + 1, std::memory_order_release);
+}
+
+struct Profile_Zone
+{
+	const char* name;
+	uint64_t begin; // 0 when the profiler was off
+
+	Profile_Zone(const char* zone_name)
+	{
+		name  = zone_name;
+		begin = global_profiler.enabled.load(std::memory_order_relaxed) ? profiler_now() : 0;
+	}
+	~Profile_Zone()
+	{
+		if (begin) profiler_record(name, begin, profiler_now());
+	}
+};
+void end(Profile_Zone& zone)
+{
+	if (zone.begin) profiler_record(zone.name, zone.begin, profiler_now());
+	zone.begin = 0;
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) Profile_Zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+
+// every zone as a complete ("X") event, timestamps in us from profiler_start()
+bool profiler_write_trace(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+	{
+		printf("ERROR : can't write '%s'\n", path);
+		return false;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+	bool first = true;
+	uint num_threads = global_profiler.num_threads;
+	for (uint t = 0; t < num_threads; t++)
+	{
+		Profiler_Thread& thread = global_profiler.threads[t];
+
+		uint64_t count = thread.count.load(std::memory_order_acquire);
+		if (count == 0) continue;
+
+		char thread_name[32];
+		if (thread.name) snprintf(thread_name, sizeof(thread_name), "%s", thread.name);
+		else             snprintf(thread_name, sizeof(thread_name), "thread %u", thread.id);
+
+		fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+			first ? "" : ",\n", thread.id, thread_name);
+		first = false;
+
+		uint64_t oldest = count > PROFILER_RING_SIZE ? count - PROFILER_RING_SIZE : 0;
+		for (uint64_t i = oldest; i < count; i++)
+		{
+			Profile_Event event = thread.events[i & (PROFILER_RING_SIZE - 1)];
+			if (event.begin < global_profiler.start) continue;
+
+			fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+				event.name, thread.id, (event.begin - global_profiler.start) / 1e3, (event.end - event.begin) / 1e3);
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	return true;
+}
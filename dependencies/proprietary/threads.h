@@ -0,0 +1,300 @@
+// worker threads, page allocation & mapped files
+// expects uint to be defined (mathematics.h or window.h)
+
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include <proprietary/profiler.h>
+
+#ifndef _WIN32
+	#include <pthread.h>
+	#include <sched.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+// ------------------------------------------------- //
+// ----------------- Multithreading ---------------- //
+// ------------------------------------------------- //
+
+/* -- how 2 use the thread pool --
+
+	Thread_Pool pool = {};
+	init(&pool); // one thread per core, the calling thread is thread 0
+
+	void job(uint index, uint thread_index, void* params) { ... }
+	parallel_for(&pool, 1024, job, &params); // returns when all 1024 jobs are done
+*/
+
+#define MAX_THREADS 64
+
+typedef void job_function(uint index, uint thread_index, void* params);
+
+struct Thread_Pool
+{
+	std::thread* threads; // [num_threads - 1] workers, the caller is thread 0
+	uint num_threads;
+
+	// the job currently running
+	job_function* job;
+	void* params;
+	uint job_count;
+	bool static_schedule;
+	std::atomic<uint> next_index;
+	std::atomic<uint> num_working;
+
+	uint generation; // bumped for every parallel_for
+	bool quit;
+
+	std::mutex lock;
+	std::condition_variable wake, done;
+};
+
+uint num_hardware_threads()
+{
+	uint count = std::thread::hardware_concurrency();
+	return count ? count : 1;
+}
+
+// keeps a thread on one core so its caches (& the memory it first touched) stay local
+void pin_thread(std::thread::native_handle_type thread, uint core)
+{
+#ifdef _WIN32
+	if (core < 64) SetThreadAffinityMask((HANDLE)thread, 1ull << core);
+#else
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(core % CPU_SETSIZE, &cpu_set);
+	pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set);
+#endif
+}
+void pin_current_thread(uint core)
+{
+#ifdef _WIN32
+	if (core < 64) SetThreadAffinityMask(GetCurrentThread(), 1ull << core);
+#else
+	pin_thread(pthread_self(), core);
+#endif
+}
+
+void thread_pool_work(Thread_Pool* pool, uint thread_index)
+{
+	PROFILE_SCOPE("parallel_for");
+
+	if (pool->static_schedule) // same thread gets the same jobs every time
+	{
+		uint first = (uint)(((uint64_t)pool->job_count * (thread_index + 0)) / pool->num_threads);
+		uint last  = (uint)(((uint64_t)pool->job_count * (thread_index + 1)) / pool->num_threads);
+
+		for (uint i = first; i < last; i++) pool->job(i, thread_index, pool->params);
+	}
+	else
+	{
+		uint i;
+		while ((i = pool->next_index++) < pool->job_count) pool->job(i, thread_index, pool->params);
+	}
+}
+void thread_pool_worker(Thread_Pool* pool, uint thread_index)
+{
+	uint generation = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(pool->lock);
+			pool->wake.wait(lock, [&] { return pool->quit || pool->generation != generation; });
+			if (pool->quit) return;
+			generation = pool->generation;
+		}
+
+		thread_pool_work(pool, thread_index);
+
+		if (--pool->num_working == 0)
+		{
+			std::lock_guard<std::mutex> lock(pool->lock);
+			pool->done.notify_one();
+		}
+	}
+}
+
+// num_threads = 0 uses every core
+void init(Thread_Pool* pool, uint num_threads = 0, bool pin_threads = false)
+{
+	if (num_threads == 0) num_threads = num_hardware_threads();
+	if (num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+
+	pool->num_threads = num_threads;
+	pool->generation  = 0;
+	pool->quit        = false;
+	pool->threads     = new std::thread[num_threads - 1];
+
+	for (uint i = 1; i < num_threads; i++)
+	{
+		pool->threads[i - 1] = std::thread(thread_pool_worker, pool, i);
+		if (pin_threads) pin_thread(pool->threads[i - 1].native_handle(), i);
+	}
+
+	if (pin_threads) pin_current_thread(0);
+}
+void shutdown(Thread_Pool* pool)
+{
+	{
+		std::lock_guard<std::mutex> lock(pool->lock);
+		pool->quit = true;
+	}
+	pool->wake.notify_all();
+
+	for (uint i = 0; i < pool->num_threads - 1; i++) pool->threads[i].join();
+	delete[] pool->threads;
+
+	pool->threads = NULL;
+	pool->num_threads = 0;
+}
+
+// runs job(0 .. count - 1) across the pool & waits for all of them, pool can be NULL
+// static_schedule splits the jobs into one contiguous range per thread instead of handing them out
+void parallel_for(Thread_Pool* pool, uint count, job_function* job, void* params, bool static_schedule = false)
+{
+	if (!pool || pool->num_threads <= 1 || count <= 1)
+	{
+		for (uint i = 0; i < count; i++) job(i, 0, params);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pool->lock);
+		pool->job             = job;
+		pool->params          = params;
+		pool->job_count       = count;
+		pool->static_schedule = static_schedule;
+		pool->next_index      = 0;
+		pool->num_working     = pool->num_threads - 1;
+		pool->generation++;
+	}
+	pool->wake.notify_all();
+
+	thread_pool_work(pool, 0);
+
+	std::unique_lock<std::mutex> lock(pool->lock);
+	pool->done.wait(lock, [&] { return pool->num_working == 0; });
+}
+
+// ------------------------------------------------- //
+// --------------------- Memory -------------------- //
+// ------------------------------------------------- //
+
+// zeroed pages straight from the os. nothing is backed by physical memory until it is first
+// written, so on numa machines the thread that touches a page first decides which node it lives on.
+// huge pages are a hint : if the os refuses them (no privilege / none reserved) normal pages are used
+void* os_alloc(size_t size, bool huge_pages = false)
+{
+#ifdef _WIN32
+	if (huge_pages)
+	{
+		// needs SeLockMemoryPrivilege, large pages are committed (& placed) immediately
+		size_t page_size = GetLargePageMinimum();
+		if (page_size)
+		{
+			size_t large_size = (size + page_size - 1) & ~(page_size - 1);
+			void* memory = VirtualAlloc(NULL, large_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (memory) return memory;
+		}
+	}
+
+	return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	if (huge_pages)
+	{
+	#ifdef MAP_HUGETLB
+		void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED) return memory;
+	#endif
+	}
+
+	void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) return NULL;
+
+	#ifdef MADV_HUGEPAGE
+	if (huge_pages) madvise(memory, size, MADV_HUGEPAGE); // transparent huge pages
+	#endif
+
+	return memory;
+#endif
+}
+void os_free(void* memory, size_t size)
+{
+	if (!memory) return;
+
+#ifdef _WIN32
+	VirtualFree(memory, 0, MEM_RELEASE);
+#else
+	munmap(memory, size);
+#endif
+}
+
+// how a mapped file is going to be read, so the os can read ahead of it
+enum File_Hint
+{
+	FILE_HINT_NONE,
+	FILE_HINT_SEQUENTIAL, // front to back, once. pages behind the reader can go early
+	FILE_HINT_WILLNEED,   // all of it, soon. the os starts reading it in right away
+};
+
+// a whole file mapped read only, pages come in from the os file cache as they are touched.
+// NULL when it can't be opened or is empty. windows only takes the sequential hint
+const void* os_map_file(const char* path, size_t* size, File_Hint hint = FILE_HINT_NONE)
+{
+	*size = 0;
+
+#ifdef _WIN32
+	DWORD flags = (hint == FILE_HINT_SEQUENTIAL) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL;
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+	if (file == INVALID_HANDLE_VALUE) return NULL;
+
+	LARGE_INTEGER file_size = {};
+	GetFileSizeEx(file, &file_size);
+
+	HANDLE mapping = file_size.QuadPart ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	CloseHandle(file);
+	if (!mapping) return NULL;
+
+	const void* memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping); // the view keeps it alive
+	if (!memory) return NULL;
+
+	*size = (size_t)file_size.QuadPart;
+	return memory;
+#else
+	int file = open(path, O_RDONLY);
+	if (file < 0) return NULL;
+
+	struct stat info = {};
+	fstat(file, &info);
+
+	void* memory = info.st_size ? mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+	close(file); // so does the mapping
+	if (memory == MAP_FAILED) return NULL;
+
+	if (hint == FILE_HINT_SEQUENTIAL) madvise(memory, info.st_size, MADV_SEQUENTIAL);
+	if (hint == FILE_HINT_WILLNEED  ) madvise(memory, info.st_size, MADV_WILLNEED);
+
+	*size = (size_t)info.st_size;
+	return memory;
+#endif
+}
+void os_unmap_file(const void* memory, size_t size)
+{
+	if (!memory) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(memory);
+#else
+	munmap((void*)memory, size);
+#endif
+}
@@ -0,0 +1,219 @@
+// textures decoded on worker threads while the main thread gets on with startup (shaders, meshes, simulation).
+// every texture id exists as soon as it is requested. the main thread uploads each image through a pixel unpack
+// buffer the moment it is decoded & the texture can be sampled from then on. cubemaps once all 6 faces are in.
+// textures with a baked .tex file (baked_textures.h) skip all of this & are loaded from it right away
+
+#define ASSET_MAX_IMAGES 32
+
+struct Asset_Image
+{
+	const char* path;
+	GLuint texture;
+	GLenum target; // GL_TEXTURE_2D or a face of GL_TEXTURE_CUBE_MAP
+
+	// from the worker that decoded it
+	byte* pixels; // rgba, NULL when the file couldn't be read
+	int width, height;
+
+	bool uploaded;
+	bool missing; // couldn't be read, a cubemap without it stays without mips
+};
+
+struct Asset_Loader
+{
+	Asset_Image images[ASSET_MAX_IMAGES];
+	uint num_images;
+
+	std::thread* threads;
+	uint num_threads;
+	std::atomic<uint> next_image; // the next one a worker decodes
+
+	std::mutex lock;
+	std::condition_variable decoded;
+	uint ready[ASSET_MAX_IMAGES]; // decoded & waiting for the main thread
+	uint num_ready;
+	uint num_uploaded;
+
+	GLuint pbo;
+	uint64_t start; // ns, when the workers started
+};
+
+// all images go through the same buffer, it is orphaned for every upload so the copy never waits on the last one
+void asset_upload(Asset_Loader& loader, Asset_Image& image)
+{
+	PROFILE_SCOPE("upload image");
+
+	image.uploaded = true;
+	loader.num_uploaded++;
+
+	if (!image.pixels)
+	{
+		image.missing = true;
+		out("ERROR : '" << image.path << "' NOT FOUND!");
+		return;
+	}
+
+	uint size = image.width * image.height * 4;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, loader.pbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	memcpy(mapped, image.pixels, size);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	stbi_image_free(image.pixels);
+	image.pixels = NULL;
+
+	bool cubemap = (image.target != GL_TEXTURE_2D);
+	GLenum binding = cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(binding, image.texture);
+	glTexImage2D(image.target, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// a cubemap is complete with its last face, & only if all of them were there
+	bool complete = true;
+	if (cubemap)
+	{
+		for (uint i = 0; i < loader.num_images; i++)
+		{
+			Asset_Image& face = loader.images[i];
+			if (face.texture == image.texture && (!face.uploaded || face.missing)) complete = false;
+		}
+	}
+
+	// only filters that sample the mips need them, the sky is plain GL_LINEAR
+	GLint min_filter = GL_LINEAR;
+	glGetTexParameteriv(binding, GL_TEXTURE_MIN_FILTER, &min_filter);
+	bool mipmapped = (min_filter != GL_LINEAR && min_filter != GL_NEAREST);
+
+	if (complete && mipmapped) glGenerateMipmap(binding);
+	glBindTexture(binding, 0);
+}
+
+void asset_loader_worker(Asset_Loader* loader)
+{
+	profiler_set_thread_name("asset loader");
+
+	while (true)
+	{
+		uint index = loader->next_image++;
+		if (index >= loader->num_images) return;
+
+		Asset_Image& image = loader->images[index];
+		{
+			PROFILE_SCOPE("decode image");
+
+			int n;
+			image.pixels = load_image(image.path, &image.width, &image.height, &n, 4);
+		}
+
+		std::lock_guard<std::mutex> lock(loader->lock);
+		loader->ready[loader->num_ready++] = index;
+		loader->decoded.notify_one();
+	}
+}
+
+// same sampling as import_texture()
+GLuint asset_load_texture(Asset_Loader& loader, const char* path)
+{
+	char baked_path[256] = {};
+	baked_texture_path(baked_path, sizeof(baked_path), path);
+
+	GLuint id = load_baked_texture(baked_path);
+	if (id) return id;
+
+	glGenTextures(1, &id);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, id);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (loader.num_images < ASSET_MAX_IMAGES)
+		loader.images[loader.num_images++] = { path, id, GL_TEXTURE_2D };
+
+	return id;
+}
+
+// faces in the order +x, -x, +y, -y, +z, -z. same sampling as createCubemap()
+GLuint asset_load_cubemap(Asset_Loader& loader, const char** paths, const char* baked_path)
+{
+	GLuint id = load_baked_texture(baked_path);
+	if (id) return id;
+
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, id);
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	for (uint face = 0; face < 6 && loader.num_images < ASSET_MAX_IMAGES; face++)
+		loader.images[loader.num_images++] = { paths[face], id, GLenum(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face) };
+
+	return id;
+}
+
+// after every texture is requested. num_threads = 0 uses every core
+void asset_loader_start(Asset_Loader& loader, uint num_threads = 0)
+{
+	if (num_threads == 0) num_threads = num_hardware_threads();
+	loader.num_threads = glm::min(num_threads, loader.num_images);
+
+	glGenBuffers(1, &loader.pbo);
+
+	loader.start = profiler_now();
+	loader.threads = new std::thread[loader.num_threads];
+	for (uint i = 0; i < loader.num_threads; i++)
+		loader.threads[i] = std::thread(asset_loader_worker, &loader);
+}
+
+// uploads what has been decoded since the last call, waits for the rest when wait is set
+void asset_loader_update(Asset_Loader& loader, bool wait = false)
+{
+	while (loader.num_uploaded < loader.num_images)
+	{
+		uint ready[ASSET_MAX_IMAGES];
+		uint num_ready = 0;
+		{
+			std::unique_lock<std::mutex> lock(loader.lock);
+			if (wait) loader.decoded.wait(lock, [&] { return loader.num_ready > 0; });
+
+			num_ready = loader.num_ready;
+			for (uint i = 0; i < num_ready; i++) ready[i] = loader.ready[i];
+			loader.num_ready = 0;
+		}
+
+		// the copies & uploads happen outside the lock, so the workers keep going
+		for (uint i = 0; i < num_ready; i++) asset_upload(loader, loader.images[ready[i]]);
+
+		if (!wait) return;
+	}
+}
+
+// every texture uploaded, the workers gone
+void asset_loader_finish(Asset_Loader& loader)
+{
+	asset_loader_update(loader, true);
+
+	for (uint i = 0; i < loader.num_threads; i++) loader.threads[i].join();
+	delete[] loader.threads;
+
+	glDeleteBuffers(1, &loader.pbo);
+
+	print("%u images decoded on %u threads & uploaded in %.1f ms\n", loader.num_images, loader.num_threads, (profiler_now() - loader.start) / 1e6);
+
+	loader.threads     = NULL;
+	loader.num_threads = 0;
+	loader.pbo         = 0;
+}
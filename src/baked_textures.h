@@ -0,0 +1,200 @@
+// textures baked offline (run with --bake) into one .tex file each : every mip level of every face, already in the
+// format the gpu samples. loading maps the file & hands the levels straight to gl, nothing is decoded or converted.
+// color is bc1 (4 bits per texel, 1/8 of rgba8), data that can't take block artifacts stays rgba8.
+// the driver does the compression while baking, so any gl 4.3 driver with s3tc can bake
+
+#define BAKED_TEXTURE_MAGIC      0x42584554 // "TEXB"
+#define BAKED_TEXTURE_VERSION    1
+#define BAKED_TEXTURE_MAX_LEVELS 16
+
+enum Texture_Kind
+{
+	TEXTURE_COLOR, // bc1
+	TEXTURE_DATA,  // rgba8
+};
+
+struct Baked_Texture_Header
+{
+	uint   magic;
+	uint   version;
+	GLenum internal_format;
+	uint   width, height; // of level 0
+	uint   num_faces;     // 1, or 6 for a cubemap (+x, -x, +y, -y, +z, -z)
+	uint   num_levels;
+
+	// from the start of the file
+	uint level_offset[6][BAKED_TEXTURE_MAX_LEVELS];
+	uint level_size  [6][BAKED_TEXTURE_MAX_LEVELS];
+};
+
+// "content/textures/noise.png" -> "content/textures/noise.tex"
+void baked_texture_path(char* baked_path, uint size, const char* path)
+{
+	snprintf(baked_path, size, "%s", path);
+
+	char* extension = strrchr(baked_path, '.');
+	if (extension && (uint)(extension - baked_path) + 5 <= size) strcpy(extension, ".tex");
+}
+
+// needs a gl context. faces is 1 path, or 6 for a cubemap. mips = false keeps only level 0
+bool bake_texture(const char** faces, uint num_faces, Texture_Kind kind, const char* baked_path, bool mips = true)
+{
+	PROFILE_SCOPE("bake texture");
+
+	Baked_Texture_Header header = {};
+	header.magic           = BAKED_TEXTURE_MAGIC;
+	header.version         = BAKED_TEXTURE_VERSION;
+	header.internal_format = (kind == TEXTURE_COLOR) ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_RGBA8;
+	header.num_faces       = num_faces;
+
+	byte* levels[6][BAKED_TEXTURE_MAX_LEVELS] = {};
+	uint offset = sizeof(header);
+
+	GLuint source, baked;
+	glGenTextures(1, &source);
+	glGenTextures(1, &baked);
+	glActiveTexture(GL_TEXTURE0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	bool ok = true;
+	for (uint face = 0; face < num_faces && ok; face++)
+	{
+		int width, height, n;
+		byte* pixels = load_image(faces[face], &width, &height, &n, 4);
+		if (!pixels) { out("ERROR : '" << faces[face] << "' NOT FOUND!"); ok = false; break; }
+
+		header.width  = width;
+		header.height = height;
+		header.num_levels = 1;
+		if (mips) while ((glm::max(width, height) >> header.num_levels) > 0 && header.num_levels < BAKED_TEXTURE_MAX_LEVELS) header.num_levels++;
+
+		// the mips are filtered from the full image, then every level is compressed on its own
+		glBindTexture(GL_TEXTURE_2D, source);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		if (mips) glGenerateMipmap(GL_TEXTURE_2D);
+		stbi_image_free(pixels);
+
+		for (uint level = 0; level < header.num_levels; level++)
+		{
+			int level_width  = glm::max(1, width  >> level);
+			int level_height = glm::max(1, height >> level);
+
+			byte* rgba = Alloc(byte, level_width * level_height * 4);
+			glBindTexture(GL_TEXTURE_2D, source);
+			glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+
+			uint size = level_width * level_height * 4;
+			if (kind == TEXTURE_COLOR)
+			{
+				GLint compressed_size = 0;
+				glBindTexture(GL_TEXTURE_2D, baked);
+				glTexImage2D(GL_TEXTURE_2D, 0, header.internal_format, level_width, level_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &compressed_size);
+
+				free(rgba);
+				size = compressed_size;
+				rgba = Alloc(byte, size);
+				glGetCompressedTexImage(GL_TEXTURE_2D, 0, rgba);
+			}
+
+			levels[face][level] = rgba;
+			header.level_offset[face][level] = offset;
+			header.level_size  [face][level] = size;
+			offset += size;
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDeleteTextures(1, &source);
+	glDeleteTextures(1, &baked);
+
+	FILE* file = ok ? fopen(baked_path, "wb") : NULL;
+	if (ok && !file) out("ERROR : can't write '" << baked_path << "'");
+
+	if (file)
+	{
+		fwrite(&header, sizeof(header), 1, file);
+		for (uint face = 0; face < num_faces; face++)
+		for (uint level = 0; level < header.num_levels; level++)
+			fwrite(levels[face][level], 1, header.level_size[face][level], file);
+		fclose(file);
+
+		print("baked %s : %ux%u, %u faces, %u levels, %.1f MB\n", baked_path, header.width, header.height, num_faces, header.num_levels, offset / 1e6);
+	}
+
+	for (uint face = 0; face < 6; face++)
+	for (uint level = 0; level < BAKED_TEXTURE_MAX_LEVELS; level++)
+		free(levels[face][level]);
+
+	return file != NULL;
+}
+
+// 0 when there is no baked file or it is from another version, then the source has to be loaded instead.
+// sampled like import_texture() & createCubemap()
+GLuint load_baked_texture(const char* path)
+{
+	PROFILE_SCOPE("load_baked_texture");
+
+	File_View view = read_file(path, FILE_HINT_SEQUENTIAL);
+	if (!view.data) return 0;
+
+	const byte* file = view.data;
+	size_t size = view.size;
+
+	const Baked_Texture_Header* header = (const Baked_Texture_Header*)file;
+
+	bool valid = size >= sizeof(Baked_Texture_Header) && header->magic == BAKED_TEXTURE_MAGIC && header->version == BAKED_TEXTURE_VERSION
+		&& (header->num_faces == 1 || header->num_faces == 6) && header->num_levels > 0 && header->num_levels <= BAKED_TEXTURE_MAX_LEVELS;
+
+	for (uint face = 0; valid && face < header->num_faces; face++)
+	for (uint level = 0; level < header->num_levels; level++)
+		if ((size_t)header->level_offset[face][level] + header->level_size[face][level] > size) valid = false;
+
+	if (!valid)
+	{
+		out("ERROR : '" << path << "' is not a baked texture of this version, run with --bake");
+		return 0;
+	}
+
+	bool   cubemap    = (header->num_faces == 6);
+	bool   compressed = (header->internal_format != GL_RGBA8);
+	GLenum binding    = cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+
+	GLuint id;
+	glGenTextures(1, &id);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(binding, id);
+	glTexStorage2D(binding, header->num_levels, header->internal_format, header->width, header->height);
+
+	for (uint face  = 0; face  < header->num_faces ; face++ )
+	for (uint level = 0; level < header->num_levels; level++)
+	{
+		GLenum target = cubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+		int width  = glm::max(1, (int)header->width  >> level);
+		int height = glm::max(1, (int)header->height >> level);
+
+		const byte* data = file + header->level_offset[face][level];
+		if (compressed) glCompressedTexSubImage2D(target, level, 0, 0, width, height, header->internal_format, header->level_size[face][level], data);
+		else            glTexSubImage2D          (target, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	}
+
+	if (cubemap)
+	{
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	}
+	else
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, header->num_levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	}
+
+	glBindTexture(binding, 0);
+
+	return id;
+}
@@ -0,0 +1,152 @@
+// a mesh split into square chunks that are culled on the gpu (content/shaders/meshchunks.comp) & drawn
+// with one glMultiDrawElementsIndirect per pass. every chunk has a draw command, culled ones get 0 instances.
+// chunks are the size of the water simulation tiles, so the wet mask of the tile scheduler lines up with them
+
+#define MESH_CHUNK_SIZE WATER_SIM_TILE_SIZE // cells per side of a chunk
+
+struct Draw_Elements_Indirect_Command
+{
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLuint base_vertex;
+	GLuint base_instance;
+};
+
+struct Mesh_Chunks
+{
+	Compute_Shader find_bounds; // aabb per chunk from the mesh buffers
+	Compute_Shader cull;        // instance count per chunk for one pass
+
+	uint chunks_per_side;
+	uint num_chunks;
+
+	GLuint indices;  // the same triangles as create_mesh(), chunk by chunk
+	GLuint bounds;   // (min, max) vec4 per chunk
+	GLuint commands; // Draw_Elements_Indirect_Command per chunk
+};
+
+// chunk (cx, cz) is at index cx * chunks_per_side + cz, x/z follow the vertex order of create_mesh()
+void init(Mesh_Chunks& chunks, Mesh& mesh)
+{
+	uint size = mesh.mesh_size;
+	uint vertices_per_row = size + 1;
+
+	chunks.chunks_per_side = (size + MESH_CHUNK_SIZE - 1) / MESH_CHUNK_SIZE;
+	chunks.num_chunks      = chunks.chunks_per_side * chunks.chunks_per_side;
+
+	char defines[64] = {};
+	snprintf(defines, sizeof(defines), "#define BOUNDS\n#define CHUNK_SIZE %d\n", MESH_CHUNK_SIZE);
+	load(&chunks.find_bounds, "content/shaders/meshchunks.comp", defines);
+
+	snprintf(defines, sizeof(defines), "#define CHUNK_SIZE %d\n", MESH_CHUNK_SIZE);
+	load(&chunks.cull, "content/shaders/meshchunks.comp", defines);
+
+	uint* indices = Alloc(uint, size * size * 6);
+	Draw_Elements_Indirect_Command* commands = Alloc(Draw_Elements_Indirect_Command, chunks.num_chunks);
+
+	uint i = 0;
+	for (uint cx = 0; cx < chunks.chunks_per_side; cx++) {
+	for (uint cz = 0; cz < chunks.chunks_per_side; cz++)
+	{
+		Draw_Elements_Indirect_Command& command = commands[(cx * chunks.chunks_per_side) + cz];
+		command.first_index    = i;
+		command.instance_count = 1;
+
+		uint x_end = glm::min((cx + 1) * MESH_CHUNK_SIZE, size);
+		uint z_end = glm::min((cz + 1) * MESH_CHUNK_SIZE, size);
+
+		for (uint x = cx * MESH_CHUNK_SIZE; x < x_end; x++) {
+		for (uint z = cz * MESH_CHUNK_SIZE; z < z_end; z++)
+		{
+			// same triangles & winding as create_mesh()
+			indices[i++] = (x + 0) * vertices_per_row + (z + 0);
+			indices[i++] = (x + 0) * vertices_per_row + (z + 1);
+			indices[i++] = (x + 1) * vertices_per_row + (z + 1);
+
+			indices[i++] = (x + 0) * vertices_per_row + (z + 0);
+			indices[i++] = (x + 1) * vertices_per_row + (z + 1);
+			indices[i++] = (x + 1) * vertices_per_row + (z + 0);
+		} }
+
+		command.count = i - command.first_index;
+	} }
+
+	glGenBuffers(1, &chunks.indices);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunks.indices);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * i, indices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &chunks.bounds);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, chunks.bounds);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(vec4) * 2 * chunks.num_chunks, NULL, GL_DYNAMIC_COPY);
+
+	glGenBuffers(1, &chunks.commands);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, chunks.commands);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Draw_Elements_Indirect_Command) * chunks.num_chunks, commands, GL_DYNAMIC_COPY);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	free(indices);
+	free(commands);
+}
+void free(Mesh_Chunks& chunks)
+{
+	glDeleteBuffers(1, &chunks.indices);
+	glDeleteBuffers(1, &chunks.bounds);
+	glDeleteBuffers(1, &chunks.commands);
+	chunks = {};
+}
+
+// binds the program & the mesh buffers meshchunks.comp reads
+void mesh_chunks_bind(Mesh_Chunks& chunks, Compute_Shader shader, Mesh& mesh)
+{
+	glUseProgram(shader.id);
+
+	// how binding 0 is read : vec4 positions, vec2 state or packed half state
+	int format = 0;
+	if (mesh.state_format == GL_RG32F) format = 1;
+	if (mesh.state_format == GL_RG16F) format = 2;
+
+	glUniform1i(0, mesh.mesh_size + 1     );
+	glUniform1i(1, format                 );
+	glUniform1i(2, mesh.displacement != 0 );
+	glUniform1i(3, chunks.chunks_per_side );
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mesh.state_format ? mesh.state[mesh.current] : mesh.positions);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mesh.displacement);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, chunks.bounds    );
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, chunks.commands  );
+}
+
+// once for static meshes, after every update for simulated ones
+void mesh_chunks_find_bounds(Mesh_Chunks& chunks, Mesh& mesh)
+{
+	mesh_chunks_bind(chunks, chunks.find_bounds, mesh);
+	glDispatchCompute(chunks.chunks_per_side, chunks.chunks_per_side, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// culls the chunks against proj_view (the mesh at world_position 0) & draws the rest with shader, which has its
+// uniforms set already. with a tile_wet mask (Water_Simulation::tile_wet) dry chunks are skipped too
+void render(Mesh_Chunks& chunks, Shader shader, Mesh& mesh, mat4 proj_view, GLuint tile_wet = 0, uint tiles_per_side = 0)
+{
+	mesh_chunks_bind(chunks, chunks.cull, mesh);
+
+	glUniformMatrix4fv(4, 1, GL_FALSE, (float*)&proj_view);
+	glUniform1i(8, tile_wet ? tiles_per_side : 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, tile_wet);
+
+	glDispatchCompute((chunks.num_chunks + 63) / 64, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+	bind(shader);
+
+	glBindVertexArray(mesh.VAO[mesh.state_format ? mesh.current : 0]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunks.indices);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, chunks.commands);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, chunks.num_chunks, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
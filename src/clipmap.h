@@ -0,0 +1,158 @@
+// geometry clipmap (losasso & hoppe 2004) : nested square rings of the same vertex count centred on the camera.
+// level l has a vertex every 2^l cells of the mesh it draws & fills the hole in the middle of level l + 1,
+// so the vertex count grows with the log of the mesh size instead of its area.
+// the vertex shaders build x/z from the level grid & read heights & normals straight from the mesh buffers.
+// towards its outer edge a level blends into the heights of the next one, so the T-junctions there don't crack
+
+#define CLIPMAP_RESOLUTION 128 // cells per side of a level, has to be a multiple of 8 & at least 32
+#define CLIPMAP_MAX_LEVELS 16
+
+struct Clipmap
+{
+	GLuint VAO;     // no attributes, the vertex shaders only use gl_VertexID
+	GLuint indices; // the full grid, then the ring for each of the 4 places the hole can be in
+
+	uint resolution;
+	uint first[5]; // per index range
+	uint count[5];
+};
+
+// indices of the level grid, x/z follow the vertex order of create_mesh(). cells of the hole are left out
+uint clipmap_add_cells(uint* indices, uint resolution, ivec2 hole_min, ivec2 hole_max)
+{
+	uint vertices_per_row = resolution + 1;
+
+	uint i = 0;
+	for (int x = 0; x < (int)resolution; x++) {
+	for (int z = 0; z < (int)resolution; z++)
+	{
+		if (x >= hole_min.x && x < hole_max.x && z >= hole_min.y && z < hole_max.y) continue;
+
+		// same triangles & winding as create_mesh()
+		indices[i++] = (x + 0) * vertices_per_row + (z + 0);
+		indices[i++] = (x + 0) * vertices_per_row + (z + 1);
+		indices[i++] = (x + 1) * vertices_per_row + (z + 1);
+
+		indices[i++] = (x + 0) * vertices_per_row + (z + 0);
+		indices[i++] = (x + 1) * vertices_per_row + (z + 1);
+		indices[i++] = (x + 1) * vertices_per_row + (z + 0);
+	} }
+
+	return i;
+}
+
+void init(Clipmap& clipmap, uint resolution = CLIPMAP_RESOLUTION)
+{
+	uint K = resolution;
+	uint max_indices = (K * K * 6) * 5;
+	uint* indices = Alloc(uint, max_indices);
+
+	clipmap.resolution = K;
+
+	// level 0 has no hole, the others have level - 1 in there, K / 4 or K / 4 + 1 cells in depending on where it snapped to
+	uint num_indices = 0;
+	for (uint range = 0; range < 5; range++)
+	{
+		ivec2 hole_min = ivec2(0), hole_max = ivec2(0);
+		if (range > 0)
+		{
+			ivec2 parity = ivec2((range - 1) & 1, (range - 1) >> 1);
+			hole_min = ivec2(K / 4) + parity;
+			hole_max = hole_min + ivec2(K / 2);
+		}
+
+		clipmap.first[range] = num_indices;
+		clipmap.count[range] = clipmap_add_cells(indices + num_indices, K, hole_min, hole_max);
+		num_indices += clipmap.count[range];
+	}
+
+	glGenBuffers(1, &clipmap.indices);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, clipmap.indices);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * num_indices, indices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glGenVertexArrays(1, &clipmap.VAO);
+
+	free(indices);
+}
+void free(Clipmap& clipmap)
+{
+	glDeleteBuffers(1, &clipmap.indices);
+	glDeleteVertexArrays(1, &clipmap.VAO);
+	clipmap = {};
+}
+
+// enough levels for the coarsest to reach past the far side of the mesh from anywhere on it
+uint clipmap_num_levels(uint resolution, uint mesh_size)
+{
+	uint reach = resolution / 2 - 2; // in cells of a level, the closest its outer edge gets to the center
+
+	uint num_levels = 1;
+	while ((reach << (num_levels - 1)) < mesh_size && num_levels < CLIPMAP_MAX_LEVELS) num_levels++;
+
+	return num_levels;
+}
+
+// draws mesh (at world_position 0) as clipmap levels around center with the bound shader.
+// heights, normals & displacement come from the mesh buffers, bound as shader storage 0, 1 & 2
+void render(Clipmap& clipmap, Mesh& mesh, vec3 center)
+{
+	int K    = clipmap.resolution;
+	int size = mesh.mesh_size;
+
+	// how the vertex shaders read binding 0 : vec4 positions, vec2 state or packed half state
+	int format = 0;
+	if (mesh.state_format == GL_RG32F) format = 1;
+	if (mesh.state_format == GL_RG16F) format = 2;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mesh.state_format ? mesh.state[mesh.current] : mesh.positions);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mesh.normals);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mesh.displacement);
+
+	// in cells, kept on the mesh so the coarsest level always covers all of it
+	vec2 c = glm::clamp(vec2(center.x, center.z) * float(size), vec2(0), vec2(size));
+
+	// the locations of the clipmap uniforms in the vertex shaders
+	set_int (10, K);                      // ClipmapResolution
+	set_int (15, format);                 // ClipmapFormat
+	set_int (16, mesh.displacement != 0); // ClipmapDisplacement
+	set_int (17, size + 1);               // ClipmapDimension
+	set_vec2(13, c);                      // ClipmapCenter
+
+	glBindVertexArray(clipmap.VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, clipmap.indices);
+
+	uint num_levels = clipmap_num_levels(K, size);
+	for (uint level = 0; level < num_levels; level++)
+	{
+		int stride = 1 << level;
+
+		// snapped to every other vertex, so the even ones line up with the next level
+		ivec2 snapped = ivec2(glm::floor(c / float(2 * stride))) * (2 * stride);
+		ivec2 origin  = snapped - ivec2((K / 2) * stride);
+
+		uint range = 0;
+		if (level > 0)
+		{
+			ivec2 parity = ivec2(glm::floor(c / float(stride))) - snapped / stride;
+			range = 1 + parity.x + 2 * parity.y;
+		}
+
+		// the outer edge is always at least K / 2 - 2 strides from the center & the hole at most K / 4 + 1,
+		// so the blend runs over the band in between. the coarsest level has nothing to blend into
+		vec2 morph = vec2(K / 2 - 2 - K / 8, K / 2 - 2);
+		if (level == num_levels - 1) morph = vec2(K, K + 1);
+
+		set_ivec2(11, origin); // ClipmapOrigin
+		set_int  (12, stride); // ClipmapStride
+		set_vec2 (14, morph ); // ClipmapMorph
+
+		glDrawElements(GL_TRIANGLES, clipmap.count[range], GL_UNSIGNED_INT, (void*)(sizeof(GLuint) * clipmap.first[range]));
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	// render(Mesh&) with the same shader draws the whole grid again
+	set_int(10, 0);
+}
@@ -0,0 +1,395 @@
+// every file the app reads (shader sources, images, baked textures) mapped read only & used straight from the
+// mapping, nothing is copied into memory of our own. the mappings stay open until file_reader_release(), so a
+// file read more than once (a compute shader compiled with different defines) is mapped once.
+// prefetch_file() queues a file for the reader thread, which maps it & touches every page so it is in memory
+// by the time read_file() asks for it. read_file() on a file nobody prefetched maps it on the calling thread.
+// with an archive open (open_file_archive()) the files in it come straight out of its one mapping instead
+
+#define MAX_OPEN_FILES 64
+#define FILE_PAGE_SIZE 4096
+
+// an archive : a header, a hash table of the file names, the names, then every file 64 byte aligned.
+// the files are stored as they are, so read_file() can return pointers into the mapping. pack_files() writes it
+#define FILE_ARCHIVE_MAGIC     0x4B434150 // "PACK"
+#define FILE_ARCHIVE_VERSION   1
+#define FILE_ARCHIVE_ALIGNMENT 64
+
+struct File_Archive_Header
+{
+	uint magic;
+	uint version;
+	uint num_files;
+	uint num_slots;  // of the hash table right after this, a power of 2
+	uint names_size; // of the names after the table, all 0 terminated
+};
+
+struct File_Archive_Slot
+{
+	uint64_t hash;
+	uint     name;   // offset into the names, 0 for an empty slot
+	uint     pad;
+	uint64_t offset; // from the start of the archive
+	uint64_t size;
+};
+
+struct File_View
+{
+	const byte* data; // NULL when the file couldn't be read
+	size_t size;
+};
+
+enum File_State
+{
+	FILE_QUEUED,  // prefetched, nobody has started on it yet
+	FILE_MAPPING,
+	FILE_MAPPED,
+};
+
+struct File_Request
+{
+	char path[256];
+	File_Hint  hint;
+	File_State state;
+	File_View  view;
+};
+
+struct File_Reader
+{
+	File_Request requests[MAX_OPEN_FILES];
+	uint num_requests;
+
+	std::thread* thread;
+	std::mutex lock;
+	std::condition_variable changed; // a request was queued or mapped
+	bool quit;
+
+	uint num_prefetched; // mapped by the reader thread before anyone asked
+	size_t mapped_bytes;
+
+	const byte* archive;
+	size_t archive_size;
+	uint num_archive_reads;
+};
+
+static File_Reader global_file_reader;
+
+// fnv-1a, like the program cache
+uint64_t file_name_hash(const char* name)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (const char* c = name; *c; c++)
+	{
+		hash ^= (byte)*c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// maps the whole archive, read_file() looks in it first from now on. false when it is missing or invalid
+bool open_file_archive(const char* path)
+{
+	PROFILE_SCOPE("open_file_archive");
+
+	File_Reader& reader = global_file_reader;
+	std::lock_guard<std::mutex> lock(reader.lock);
+	if (reader.archive) return true;
+
+	size_t size = 0;
+	const byte* archive = (const byte*)os_map_file(path, &size, FILE_HINT_WILLNEED);
+	if (!archive) return false;
+
+	const File_Archive_Header* header = (const File_Archive_Header*)archive;
+
+	bool valid = size >= sizeof(File_Archive_Header) && header->magic == FILE_ARCHIVE_MAGIC && header->version == FILE_ARCHIVE_VERSION
+		&& header->num_slots && (header->num_slots & (header->num_slots - 1)) == 0 && header->num_files < header->num_slots
+		&& sizeof(File_Archive_Header) + (uint64_t)header->num_slots * sizeof(File_Archive_Slot) + header->names_size <= size;
+
+	if (!valid)
+	{
+		out("ERROR : '" << path << "' is not an archive of this version, run with --pack");
+		os_unmap_file(archive, size);
+		return false;
+	}
+
+	reader.archive      = archive;
+	reader.archive_size = size;
+
+	print("reading content from %s (%u files, %.1f MB)\n", path, header->num_files, size / 1e6);
+	return true;
+}
+
+// no data when the archive doesn't have it
+File_View find_archived_file(File_Reader& reader, const char* path)
+{
+	if (!reader.archive) return {};
+
+	const File_Archive_Header* header = (const File_Archive_Header*)reader.archive;
+	const File_Archive_Slot*   slots  = (const File_Archive_Slot*)(header + 1);
+	const char*                names  = (const char*)(slots + header->num_slots);
+
+	uint64_t hash = file_name_hash(path);
+	for (uint i = 0; i < header->num_slots; i++)
+	{
+		const File_Archive_Slot& slot = slots[(hash + i) & (header->num_slots - 1)];
+		if (slot.name == 0) return {};
+		if (slot.hash != hash || slot.name >= header->names_size || strcmp(names + slot.name, path)) continue;
+
+		if (slot.offset + slot.size > reader.archive_size) return {};
+		return { reader.archive + slot.offset, (size_t)slot.size };
+	}
+	return {};
+}
+
+File_Request* find_file_request(File_Reader& reader, const char* path)
+{
+	for (uint i = 0; i < reader.num_requests; i++)
+		if (!strcmp(reader.requests[i].path, path)) return &reader.requests[i];
+	return NULL;
+}
+
+// request has to be FILE_MAPPING & owned by the caller. the lock is let go while the file is mapped
+void map_file_request(File_Reader& reader, std::unique_lock<std::mutex>& lock, File_Request* request, bool touch_pages)
+{
+	char path[256] = {};
+	strcpy(path, request->path);
+	File_Hint hint = request->hint;
+
+	lock.unlock();
+
+	File_View view = {};
+	view.data = (const byte*)os_map_file(path, &view.size, hint);
+
+	// faults every page in here, so whoever reads the file later never waits on the disk
+	if (touch_pages)
+	{
+		volatile byte sum = 0;
+		for (size_t i = 0; i < view.size; i += FILE_PAGE_SIZE) sum += view.data[i];
+	}
+
+	lock.lock();
+
+	request->view  = view;
+	request->state = FILE_MAPPED;
+	reader.mapped_bytes += view.size;
+	reader.changed.notify_all();
+}
+
+void file_reader_worker(File_Reader* reader)
+{
+	profiler_set_thread_name("file reader");
+
+	std::unique_lock<std::mutex> lock(reader->lock);
+	while (!reader->quit)
+	{
+		File_Request* request = NULL;
+		for (uint i = 0; i < reader->num_requests && !request; i++)
+			if (reader->requests[i].state == FILE_QUEUED) request = &reader->requests[i];
+
+		if (!request)
+		{
+			reader->changed.wait(lock);
+			continue;
+		}
+
+		PROFILE_SCOPE("prefetch file");
+
+		request->state = FILE_MAPPING;
+		reader->num_prefetched++;
+		map_file_request(*reader, lock, request, true);
+	}
+}
+
+void file_reader_start()
+{
+	File_Reader& reader = global_file_reader;
+	if (reader.thread) return;
+
+	reader.quit   = false;
+	reader.thread = new std::thread(file_reader_worker, &reader);
+}
+
+// the reader thread maps path & pages it in while the caller gets on with something else
+void prefetch_file(const char* path, File_Hint hint = FILE_HINT_WILLNEED)
+{
+	File_Reader& reader = global_file_reader;
+	std::lock_guard<std::mutex> lock(reader.lock);
+
+	if (find_archived_file(reader, path).data) return; // the whole archive is on its way in already
+	if (find_file_request(reader, path) || reader.num_requests == MAX_OPEN_FILES) return;
+
+	File_Request& request = reader.requests[reader.num_requests++];
+	snprintf(request.path, sizeof(request.path), "%s", path);
+	request.hint  = hint;
+	request.state = FILE_QUEUED;
+
+	reader.changed.notify_all();
+}
+
+// the whole file, valid until file_reader_release(). no data when it is missing or empty, safe from any thread
+File_View read_file(const char* path, File_Hint hint = FILE_HINT_NONE)
+{
+	PROFILE_SCOPE("read_file");
+
+	File_Reader& reader = global_file_reader;
+	std::unique_lock<std::mutex> lock(reader.lock);
+
+	File_View archived = find_archived_file(reader, path);
+	if (archived.data)
+	{
+		reader.num_archive_reads++;
+		return archived;
+	}
+
+	File_Request* request = find_file_request(reader, path);
+	if (!request)
+	{
+		if (reader.num_requests == MAX_OPEN_FILES)
+		{
+			out("ERROR : more than " << MAX_OPEN_FILES << " files open, can't read '" << path << "'");
+			return {};
+		}
+
+		request = &reader.requests[reader.num_requests++];
+		snprintf(request->path, sizeof(request->path), "%s", path);
+		request->hint  = hint;
+		request->state = FILE_QUEUED;
+	}
+
+	// the reader thread hasn't got to it (or isn't running), no point waiting for it
+	if (request->state == FILE_QUEUED)
+	{
+		request->state = FILE_MAPPING;
+		map_file_request(reader, lock, request, false);
+	}
+
+	reader.changed.wait(lock, [&] { return request->state == FILE_MAPPED; });
+	return request->view;
+}
+
+// unmaps every file & the archive & stops the reader thread. nothing read before this can be used after it
+void file_reader_release()
+{
+	File_Reader& reader = global_file_reader;
+
+	if (reader.thread)
+	{
+		{
+			std::lock_guard<std::mutex> lock(reader.lock);
+			reader.quit = true;
+			reader.changed.notify_all();
+		}
+		reader.thread->join();
+		delete reader.thread;
+	}
+
+	// nothing is mapping anymore, the requests the reader thread never got to have no view
+	for (uint i = 0; i < reader.num_requests; i++)
+		os_unmap_file(reader.requests[i].view.data, reader.requests[i].view.size);
+
+	if (reader.num_requests)
+		print("%u files read (%u prefetched), %.1f MB mapped\n", reader.num_requests, reader.num_prefetched, reader.mapped_bytes / 1e6);
+	if (reader.archive)
+		print("%u reads from the archive\n", reader.num_archive_reads);
+
+	os_unmap_file(reader.archive, reader.archive_size);
+
+	reader.num_requests      = 0;
+	reader.num_prefetched    = 0;
+	reader.mapped_bytes      = 0;
+	reader.thread            = NULL;
+	reader.archive           = NULL;
+	reader.archive_size      = 0;
+	reader.num_archive_reads = 0;
+}
+
+// stbi_load() from the mapping instead of the file
+byte* load_image(const char* path, int* width, int* height, int* num_channels, int desired_channels)
+{
+	File_View file = read_file(path, FILE_HINT_SEQUENTIAL);
+	if (!file.data) return NULL;
+
+	return stbi_load_from_memory(file.data, (int)file.size, width, height, num_channels, desired_channels);
+}
+
+// the files (the ones that exist) into one archive at archive_path, found by the same paths afterwards.
+// straight from disk, not from an archive that is open
+bool pack_files(const char** paths, uint num_paths, const char* archive_path)
+{
+	PROFILE_SCOPE("pack_files");
+
+	File_Archive_Header header = {};
+	header.magic   = FILE_ARCHIVE_MAGIC;
+	header.version = FILE_ARCHIVE_VERSION;
+
+	// at most half full, so lookups stay short
+	header.num_slots = 1;
+	while (header.num_slots < num_paths * 2) header.num_slots *= 2;
+
+	header.names_size = 1; // so offset 0 is no name
+	for (uint i = 0; i < num_paths; i++) header.names_size += strlen(paths[i]) + 1;
+
+	File_Archive_Slot* slots   = Alloc(File_Archive_Slot, header.num_slots);
+	char*              names   = Alloc(char, header.names_size);
+	File_View*         files   = Alloc(File_View, num_paths);
+	uint64_t*          offsets = Alloc(uint64_t, num_paths);
+
+	uint64_t offset = sizeof(header) + header.num_slots * sizeof(File_Archive_Slot) + header.names_size;
+	uint name = 1;
+
+	for (uint i = 0; i < num_paths; i++)
+	{
+		uint64_t hash = file_name_hash(paths[i]);
+		uint slot = hash & (header.num_slots - 1);
+		while (slots[slot].name && strcmp(names + slots[slot].name, paths[i])) slot = (slot + 1) & (header.num_slots - 1);
+		if (slots[slot].name) continue; // in the list twice
+
+		files[i].data = (const byte*)os_map_file(paths[i], &files[i].size, FILE_HINT_SEQUENTIAL);
+		if (!files[i].data) { out("skipping '" << paths[i] << "', it doesn't exist"); continue; }
+
+		offset = (offset + FILE_ARCHIVE_ALIGNMENT - 1) / FILE_ARCHIVE_ALIGNMENT * FILE_ARCHIVE_ALIGNMENT;
+		offsets[i] = offset;
+
+		slots[slot].hash   = hash;
+		slots[slot].name   = name;
+		slots[slot].offset = offset;
+		slots[slot].size   = files[i].size;
+
+		strcpy(names + name, paths[i]);
+		name   += strlen(paths[i]) + 1;
+		offset += files[i].size;
+		header.num_files++;
+	}
+
+	FILE* archive = fopen(archive_path, "wb");
+	if (archive)
+	{
+		fwrite(&header, sizeof(header), 1, archive);
+		fwrite(slots, sizeof(File_Archive_Slot), header.num_slots, archive);
+		fwrite(names, 1, header.names_size, archive);
+
+		// the offsets only ever grow, so the files go in list order with zeros up to each one
+		uint64_t written = sizeof(header) + header.num_slots * sizeof(File_Archive_Slot) + header.names_size;
+		byte padding[FILE_ARCHIVE_ALIGNMENT] = {};
+
+		for (uint i = 0; i < num_paths; i++)
+		{
+			if (!files[i].data) continue;
+
+			fwrite(padding, 1, offsets[i] - written, archive);
+			fwrite(files[i].data, 1, files[i].size, archive);
+			written = offsets[i] + files[i].size;
+		}
+		fclose(archive);
+
+		print("packed %u files into %s, %.1f MB\n", header.num_files, archive_path, offset / 1e6);
+	}
+	else out("ERROR : can't write '" << archive_path << "'");
+
+	for (uint i = 0; i < num_paths; i++) os_unmap_file(files[i].data, files[i].size);
+	free(slots);
+	free(names);
+	free(files);
+	free(offsets);
+
+	return archive != NULL;
+}
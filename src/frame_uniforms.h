@@ -0,0 +1,112 @@
+// camera matrices, their products & inverses, time & framebuffer size in std140 uniform blocks every shader binds.
+// filled once per frame, so nothing in the frame loop looks uniforms up by name & no fragment inverts a matrix.
+// the FrameUniforms & PassUniforms blocks have to match these structs in every shader that declares them
+
+#define FRAME_UNIFORMS_BINDING 0
+#define PASS_UNIFORMS_BINDING  1
+#define MAX_RENDER_VIEWS       8
+
+struct Frame_Uniforms
+{
+	mat4 view;
+	mat4 proj;
+	mat4 proj_view;
+	mat4 inverse_proj_view;
+
+	// the camera of the water-map & top-view passes, looking straight down at the grid
+	mat4 top_view;
+	mat4 top_proj;
+	mat4 top_proj_view;
+	mat4 inverse_top_proj_view;
+
+	vec2  framebuffer_size;
+	float time;
+	float delta_time;
+};
+
+// what a pass renders from, one slot per view
+struct Pass_Uniforms
+{
+	mat4 proj_view;
+};
+
+struct Uniform_Buffers
+{
+	GLuint frame;
+	GLuint passes; // a Pass_Uniforms per view, each at a multiple of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	uint   pass_stride;
+	uint   num_views;
+
+	Frame_Uniforms frame_data;
+	mat4 views[MAX_RENDER_VIEWS];
+};
+
+void init(Uniform_Buffers& buffers, uint num_views)
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	buffers.num_views   = glm::min(num_views, (uint)MAX_RENDER_VIEWS);
+	buffers.pass_stride = ((sizeof(Pass_Uniforms) + alignment - 1) / alignment) * alignment;
+
+	glGenBuffers(1, &buffers.frame);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffers.frame);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(Frame_Uniforms), NULL, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &buffers.passes);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffers.passes);
+	glBufferData(GL_UNIFORM_BUFFER, buffers.pass_stride * buffers.num_views, NULL, GL_DYNAMIC_DRAW);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, buffers.frame);
+}
+void free(Uniform_Buffers& buffers)
+{
+	glDeleteBuffers(1, &buffers.frame);
+	glDeleteBuffers(1, &buffers.passes);
+	buffers = {};
+}
+
+// the products & inverses are done here once instead of per vertex & fragment
+void frame_uniforms_set(Uniform_Buffers& buffers, mat4 view, mat4 proj, mat4 top_view, mat4 top_proj, vec2 framebuffer_size, float time, float dt)
+{
+	Frame_Uniforms& frame = buffers.frame_data;
+
+	frame.view              = view;
+	frame.proj              = proj;
+	frame.proj_view         = proj * view;
+	frame.inverse_proj_view = glm::inverse(frame.proj_view);
+
+	frame.top_view              = top_view;
+	frame.top_proj              = top_proj;
+	frame.top_proj_view         = top_proj * top_view;
+	frame.inverse_top_proj_view = glm::inverse(frame.top_proj_view);
+
+	frame.framebuffer_size = framebuffer_size;
+	frame.time             = time;
+	frame.delta_time       = dt;
+}
+
+void pass_uniforms_set(Uniform_Buffers& buffers, uint view, mat4 proj_view)
+{
+	buffers.views[view] = proj_view;
+}
+
+// one upload of everything set for the frame, before its first pass
+void uniform_buffers_upload(Uniform_Buffers& buffers)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, buffers.frame);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Frame_Uniforms), &buffers.frame_data);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffers.passes);
+	for (uint i = 0; i < buffers.num_views; i++)
+		glBufferSubData(GL_UNIFORM_BUFFER, i * buffers.pass_stride, sizeof(Pass_Uniforms), &buffers.views[i]);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// makes the PassUniforms of the following draws the ones of view
+void uniform_buffers_bind_pass(Uniform_Buffers& buffers, uint view)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, PASS_UNIFORMS_BINDING, buffers.passes, view * buffers.pass_stride, sizeof(Pass_Uniforms));
+}
@@ -0,0 +1,199 @@
+// gpu time per labelled pass from GL_TIMESTAMP queries around it. every frame has its own set of queries in a ring
+// & they are only read GPU_TIMER_FRAMES_IN_FLIGHT frames later, when the gpu is long done with them, so timing never stalls.
+// keeps a rolling min / avg / p99 per pass & can write every frame out as a csv row & a json line
+
+#define GPU_TIMER_MAX_PASSES       16
+#define GPU_TIMER_FRAMES_IN_FLIGHT 4   // query sets in the ring
+#define GPU_TIMER_HISTORY          256 // frames in the rolling stats
+
+struct Gpu_Timers
+{
+	const char* labels[GPU_TIMER_MAX_PASSES];
+	uint num_passes;
+
+	// begin & end timestamp per pass, one set per frame in flight
+	GLuint queries[GPU_TIMER_FRAMES_IN_FLIGHT][2 * GPU_TIMER_MAX_PASSES];
+	uint   issued [GPU_TIMER_FRAMES_IN_FLIGHT]; // bit per pass timed in that frame, 0 once read back
+	uint   frame_number[GPU_TIMER_FRAMES_IN_FLIGHT];
+
+	uint frame; // frames begun
+	uint slot;  // frame % GPU_TIMER_FRAMES_IN_FLIGHT
+
+	// in ms, passes that didn't run in a frame count as 0
+	float history[GPU_TIMER_MAX_PASSES][GPU_TIMER_HISTORY];
+	uint  num_samples; // frames read back
+	uint  num_dropped; // frames whose queries weren't done in time
+
+	FILE* csv;  // frame, then ms per pass
+	FILE* json; // an object per line
+};
+
+void init(Gpu_Timers& timers, const char** labels, uint num_passes, const char* csv_path = NULL, const char* json_path = NULL)
+{
+	timers.num_passes = glm::min(num_passes, (uint)GPU_TIMER_MAX_PASSES);
+	for (uint i = 0; i < timers.num_passes; i++) timers.labels[i] = labels[i];
+
+	for (uint i = 0; i < GPU_TIMER_FRAMES_IN_FLIGHT; i++)
+		glGenQueries(2 * timers.num_passes, timers.queries[i]);
+
+	if (csv_path)
+	{
+		timers.csv = fopen(csv_path, "w");
+		if (!timers.csv) out("ERROR : can't write '" << csv_path << "'");
+		else
+		{
+			fprintf(timers.csv, "frame");
+			for (uint i = 0; i < timers.num_passes; i++) fprintf(timers.csv, ",%s", timers.labels[i]);
+			fprintf(timers.csv, "\n");
+		}
+	}
+
+	if (json_path)
+	{
+		timers.json = fopen(json_path, "w");
+		if (!timers.json) out("ERROR : can't write '" << json_path << "'");
+	}
+}
+void free(Gpu_Timers& timers)
+{
+	for (uint i = 0; i < GPU_TIMER_FRAMES_IN_FLIGHT; i++)
+		glDeleteQueries(2 * timers.num_passes, timers.queries[i]);
+
+	if (timers.csv ) fclose(timers.csv );
+	if (timers.json) fclose(timers.json);
+	timers = {};
+}
+
+// the results of the frame in slot into the history & the files
+void gpu_timers_read(Gpu_Timers& timers, uint slot)
+{
+	uint issued = timers.issued[slot];
+	if (!issued) return;
+
+	timers.issued[slot] = 0;
+
+	// timestamps land in order, so when the last one is there all of them are
+	uint last = 0;
+	for (uint i = 0; i < timers.num_passes; i++) if (issued & (1u << i)) last = i;
+
+	GLint available = 0;
+	glGetQueryObjectiv(timers.queries[slot][2 * last + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		timers.num_dropped++;
+		return;
+	}
+
+	uint sample = timers.num_samples++ % GPU_TIMER_HISTORY;
+	for (uint i = 0; i < timers.num_passes; i++)
+	{
+		float ms = 0;
+		if (issued & (1u << i))
+		{
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(timers.queries[slot][2 * i + 0], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(timers.queries[slot][2 * i + 1], GL_QUERY_RESULT, &end  );
+			ms = (end - begin) / 1e6f;
+		}
+
+		timers.history[i][sample] = ms;
+	}
+
+	uint frame = timers.frame_number[slot];
+
+	if (timers.csv)
+	{
+		fprintf(timers.csv, "%u", frame);
+		for (uint i = 0; i < timers.num_passes; i++) fprintf(timers.csv, ",%.4f", timers.history[i][sample]);
+		fprintf(timers.csv, "\n");
+	}
+
+	if (timers.json)
+	{
+		fprintf(timers.json, "{\"frame\": %u", frame);
+		for (uint i = 0; i < timers.num_passes; i++) fprintf(timers.json, ", \"%s\": %.4f", timers.labels[i], timers.history[i][sample]);
+		fprintf(timers.json, "}\n");
+	}
+}
+
+// reads back the oldest frame in the ring & reuses its queries
+void gpu_timers_begin_frame(Gpu_Timers& timers)
+{
+	timers.slot = timers.frame % GPU_TIMER_FRAMES_IN_FLIGHT;
+	gpu_timers_read(timers, timers.slot);
+
+	timers.frame_number[timers.slot] = timers.frame++;
+}
+
+void gpu_timer_begin(Gpu_Timers& timers, uint pass)
+{
+	glQueryCounter(timers.queries[timers.slot][2 * pass + 0], GL_TIMESTAMP);
+}
+void gpu_timer_end(Gpu_Timers& timers, uint pass)
+{
+	glQueryCounter(timers.queries[timers.slot][2 * pass + 1], GL_TIMESTAMP);
+	timers.issued[timers.slot] |= 1u << pass;
+}
+
+int compare_floats(const void* a, const void* b)
+{
+	float x = *(const float*)a, y = *(const float*)b;
+	return (x > y) - (x < y);
+}
+
+// waits for the gpu & reads back every frame still in the ring, before reporting at the end of a run
+void gpu_timers_flush(Gpu_Timers& timers)
+{
+	glFinish();
+	for (uint i = 0; i < GPU_TIMER_FRAMES_IN_FLIGHT; i++)
+		gpu_timers_read(timers, (timers.frame + i) % GPU_TIMER_FRAMES_IN_FLIGHT);
+}
+
+struct Gpu_Timer_Stats
+{
+	float min, avg, p99; // ms
+};
+
+// rolling min / avg / p99 of a pass over the last GPU_TIMER_HISTORY frames read back
+Gpu_Timer_Stats gpu_timer_stats(Gpu_Timers& timers, uint pass)
+{
+	Gpu_Timer_Stats stats = {};
+
+	uint n = glm::min(timers.num_samples, (uint)GPU_TIMER_HISTORY);
+	if (n == 0) return stats;
+
+	float sorted[GPU_TIMER_HISTORY];
+	float sum = 0;
+	for (uint s = 0; s < n; s++)
+	{
+		sorted[s] = timers.history[pass][s];
+		sum += sorted[s];
+	}
+
+	qsort(sorted, n, sizeof(float), compare_floats);
+
+	uint p99 = glm::min(n - 1, (uint)ceil(0.99f * n) - 1);
+
+	stats.min = sorted[0];
+	stats.avg = sum / n;
+	stats.p99 = sorted[p99];
+	return stats;
+}
+
+void gpu_timers_print(Gpu_Timers& timers)
+{
+	uint n = glm::min(timers.num_samples, (uint)GPU_TIMER_HISTORY);
+	if (n == 0) return;
+
+	float total = 0;
+
+	print("gpu ms over %u frames (%u dropped)  %8s %8s %8s\n", n, timers.num_dropped, "min", "avg", "p99");
+	for (uint i = 0; i < timers.num_passes; i++)
+	{
+		Gpu_Timer_Stats stats = gpu_timer_stats(timers, i);
+		print("  %-32s %8.3f %8.3f %8.3f\n", timers.labels[i], stats.min, stats.avg, stats.p99);
+
+		total += stats.avg;
+	}
+	print("  %-32s %8s %8.3f\n", "total", "", total);
+}
@@ -1,4 +1,17 @@
 #include "renderer.h"
+#include "clipmap.h"
+#include "simulation_cpu.h"
+#include "simulation_implicit_cpu.h"
+#include "simulation.h"
+#include "ocean.h"
+#include "shallow_water_cpu.h"
+#include "shallow_water.h"
+#include "chunks.h"
+#include "gpu_timers.h"
+#include "frame_uniforms.h"
+#include "render_graph.h"
+#include "baked_textures.h"
+#include "assets.h"
 
 struct Timer
 {
@@ -17,32 +30,228 @@ struct Timer
 	}
 };
 
-int main()
+// the stages of a frame timed on the gpu
+enum Gpu_Pass
 {
+	PASS_WATER_SIMULATION,
+	PASS_WATER_MAP,
+	PASS_TOP_VIEW,
+	PASS_SKY,
+	PASS_GROUND,
+	PASS_WATER,
+	PASS_COMBINE,
+
+	NUM_GPU_PASSES
+};
+
+// what the passes render from, a slot of the per pass uniforms each
+enum Render_View
+{
+	VIEW_CAMERA,
+	VIEW_TOP, // the water-map & top-view passes
+
+	NUM_RENDER_VIEWS
+};
+
+const char* sky_faces[6] = {
+	"content/textures/sky_posx.jpg", "content/textures/sky_negx.jpg",
+	"content/textures/sky_posy.jpg", "content/textures/sky_negy.jpg",
+	"content/textures/sky_posz.jpg", "content/textures/sky_negz.jpg" };
+
+// what startup reads, in about the order it reads it. prefetched at the start of run() so the reader thread has it
+// in memory by the time it is loaded. missing ones (textures that aren't baked) cost a failed open
+const char* startup_files[] = {
+	"content/textures/sky.tex", "content/textures/noise_normal.tex", "content/textures/caustic.tex",
+	"content/textures/ground.tex", "content/textures/noise.tex",
+	"content/shaders/water.vert", "content/shaders/water.frag", "content/shaders/combine.vert", "content/shaders/combine.frag",
+	"content/shaders/ground.vert", "content/shaders/ground.frag", "content/shaders/sky.vert", "content/shaders/sky.frag",
+	"content/shaders/simplewater.vert", "content/shaders/simplewater.frag",
+	"content/shaders/watersimulation.comp", "content/shaders/watertiles.comp", "content/shaders/watertemporal.comp",
+	"content/shaders/watermultigrid.comp", "content/shaders/shallowwater.comp", "content/shaders/meshchunks.comp" };
+
+// the 2d textures, in the order of app_textures
+enum App_Texture
+{
+	APP_TEXTURE_NOISE_NORMAL,
+	APP_TEXTURE_CAUSTIC,
+	APP_TEXTURE_GROUND,
+	APP_TEXTURE_NOISE,
+
+	NUM_APP_TEXTURES
+};
+
+// baked into the .tex file next to each
+struct { const char* path; Texture_Kind kind; } app_textures[NUM_APP_TEXTURES] = {
+	{ "content/textures/noise_normal.jpg", TEXTURE_COLOR }, // the shaders read it raw, all 3 channels
+	{ "content/textures/caustic.png"     , TEXTURE_COLOR },
+	{ "content/textures/ground.png"      , TEXTURE_COLOR },
+	{ "content/textures/noise.png"       , TEXTURE_DATA  },
+};
+
+#define CONTENT_ARCHIVE "content.pack"
+
+// every texture of the app into its .tex file next to it, read by asset_load_texture() & asset_load_cubemap()
+void bake_textures()
+{
+	Window window = {};
+	init_window(&window, 64, 64, "bake", true);
+
+	for (uint i = 0; i < sizeof(app_textures) / sizeof(app_textures[0]); i++)
+	{
+		char baked_path[256] = {};
+		baked_texture_path(baked_path, sizeof(baked_path), app_textures[i].path);
+		bake_texture(&app_textures[i].path, 1, app_textures[i].kind, baked_path);
+	}
+
+	// only ever sampled at level 0
+	bake_texture(sky_faces, 6, TEXTURE_COLOR, "content/textures/sky.tex", false);
+
+	file_reader_release();
+	glfwTerminate();
+}
+
+// everything startup reads into CONTENT_ARCHIVE, which run() reads instead of content/ when it is there.
+// the baked textures when there are any (--bake first), otherwise the images they are baked from
+void pack_content()
+{
+	const uint num_startup_files = sizeof(startup_files) / sizeof(startup_files[0]);
+	const uint num_app_textures  = sizeof(app_textures ) / sizeof(app_textures [0]);
+	const uint num_sky_faces     = sizeof(sky_faces    ) / sizeof(sky_faces    [0]);
+	const uint num_images        = num_app_textures + num_sky_faces;
+
+	// the archive is read like any other files, so it holds at most MAX_OPEN_FILES of them
+	if (num_startup_files + num_images > MAX_OPEN_FILES)
+	{
+		out("ERROR : more than " << MAX_OPEN_FILES << " files to pack into '" << CONTENT_ARCHIVE << "'");
+		return;
+	}
+
+	const char* paths[MAX_OPEN_FILES] = {};
+	uint num_paths = 0;
+
+	for (uint i = 0; i < num_startup_files; i++) paths[num_paths++] = startup_files[i];
+
+	const char* sources[num_images] = {};
+	const char* baked  [num_images] = {};
+	char baked_paths[num_app_textures][256] = {};
+	for (uint i = 0; i < num_app_textures; i++)
+	{
+		sources[i] = app_textures[i].path;
+		baked_texture_path(baked_paths[i], sizeof(baked_paths[i]), app_textures[i].path);
+		baked[i] = baked_paths[i];
+	}
+	for (uint i = 0; i < num_sky_faces; i++)
+	{
+		sources[num_app_textures + i] = sky_faces[i];
+		baked  [num_app_textures + i] = "content/textures/sky.tex";
+	}
+
+	for (uint i = 0; i < num_images; i++)
+	{
+		FILE* file = fopen(baked[i], "rb");
+		if (file) fclose(file);
+		else paths[num_paths++] = sources[i];
+	}
+
+	pack_files(paths, num_paths, CONTENT_ARCHIVE);
+}
+
+// what one run of the app renders. the defaults are the interactive app
+struct Run_Settings
+{
+	uint framebuffer_width  = 1920;
+	uint framebuffer_height = 1080;
+	uint terrain_size   = 200;
+	uint water_map_size = 1024;
+	uint top_view_size  = 1024;
+	bool clipmap_lod    = false; // clipmap levels around the camera instead of culled chunks
+
+	bool water_ocean   = false; // water modes, see run()
+	bool water_shallow = false;
+
+	// the wave solver
+	Water_Integrator integrator = WATER_EXPLICIT;
+	uint temporal_steps = 1; // explicit steps per dispatch
+	uint sponge_width   = 0; // cells along the edge that absorb waves
+
+	// benchmarks : a hidden window that renders into its own framebuffers for num_frames frames of a fixed dt,
+	// the camera follows camera_path & seed picks the ocean spectrum, so every build sees the same frames
+	bool headless = false;
+	uint num_frames  = 0;
+	uint seed        = 0;
+	Camera_Path camera_path = CAMERA_PATH_NONE;
+
+	const char* label  = ""; // which build this is, for comparing reports
+	FILE*       report = NULL; // a csv row per gpu pass at the end of the run
+
+	const char* gpu_timings = NULL; // every frame's gpu pass times go to <gpu_timings>.csv & .json
+};
+
+void write_report_header(FILE* report)
+{
+	fprintf(report, "label,terrain_size,water_map_size,top_view_size,width,height,clipmap,water,integrator,temporal_steps,sponge,camera_path,seed,frames,pass,min_ms,avg_ms,p99_ms\n");
+}
+
+void write_report(FILE* report, Run_Settings& settings, const char* pass, float min, float avg, float p99)
+{
+	const char* water = settings.water_ocean ? "ocean" : settings.water_shallow ? "shallow" : "waves";
+	const char* integrators[] = { "explicit", "be", "cn" };
+	const char* paths[] = { "none", "still", "orbit", "flyover" };
+
+	fprintf(report, "%s,%u,%u,%u,%u,%u,%u,%s,%s,%u,%u,%s,%u,%u,%s,%.4f,%.4f,%.4f\n", settings.label,
+		settings.terrain_size, settings.water_map_size, settings.top_view_size, settings.framebuffer_width, settings.framebuffer_height,
+		settings.clipmap_lod, water, integrators[settings.integrator], settings.temporal_steps, settings.sponge_width, paths[settings.camera_path],
+		settings.seed, settings.num_frames, pass, min, avg, p99);
+}
+
+void run(Run_Settings settings)
+{
+	Profile_Zone startup_zone("startup");
+
+	open_file_archive(CONTENT_ARCHIVE);
+	file_reader_start();
+	for (uint i = 0; i < sizeof(startup_files) / sizeof(startup_files[0]); i++) prefetch_file(startup_files[i]);
+
 	Window   window = {};
 	Mouse    mouse  = {};
 	Keyboard keys   = {};
 
-	init_window(&window, 1920, 1080);
+	init_window(&window, settings.framebuffer_width, settings.framebuffer_height, "window", settings.headless);
 	init_keyboard(&keys);
 
+	// textures, from their baked files when there are any (run with --bake). the rest are decoded on every core
+	// while the rest of startup runs, the ones that are ready get uploaded between its stages by asset_loader_update()
+	// & whatever is left by asset_loader_finish()
+	Asset_Loader assets = {};
+	GLuint skyCubemap  = asset_load_cubemap(assets, sky_faces, "content/textures/sky.tex");
+	GLuint subsurf_tex = create_subsurf_texture();
+
+	GLuint textures[NUM_APP_TEXTURES] = {};
+	for (uint i = 0; i < NUM_APP_TEXTURES; i++) textures[i] = asset_load_texture(assets, app_textures[i].path);
+	asset_loader_start(assets);
+
 	Shader water_shader = {};
 	load(&water_shader, "content/shaders/water.vert", "content/shaders/water.frag");
+	asset_loader_update(assets);
 
 	Shader combine_shader = {};
 	load(&combine_shader, "content/shaders/combine.vert", "content/shaders/combine.frag");
+	asset_loader_update(assets);
 
 	Shader ground_shader = {};
 	load(&ground_shader, "content/shaders/ground.vert", "content/shaders/ground.frag");
+	asset_loader_update(assets);
 
 	Shader sky_shader = {};
 	load(&sky_shader, "content/shaders/sky.vert", "content/shaders/sky.frag");
+	asset_loader_update(assets);
 
 	Shader simple_water_shader = {};
 	load(&simple_water_shader, "content/shaders/simplewater.vert", "content/shaders/simplewater.frag");
+	asset_loader_update(assets);
 
-	Compute_Shader water_sim_comp = {};
-	load(&water_sim_comp, "content/shaders/watersimulation.comp");
+	// simulation state per cell, GL_RG16F halves the bandwidth again
+	GLenum water_state_format = GL_RG32F;
 
 	Camera camera = { {0, .25, 0} };
 
@@ -72,133 +281,280 @@ int main()
 	setAttribPointer(quad.VAO, Attrib::Position, quad.AB, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
 	setAttribPointer(quad.VAO, Attrib::TexCoord, quad.AB, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, texCoord));
 
-	int framebuf_width, framebuf_height;
-	glfwGetFramebufferSize(window.instance, &framebuf_width, &framebuf_height);
+	// a hidden window may not get the size it asked for, its framebuffer isn't drawn to anyway
+	int framebuf_width = settings.framebuffer_width, framebuf_height = settings.framebuffer_height;
+	if (!settings.headless) glfwGetFramebufferSize(window.instance, &framebuf_width, &framebuf_height);
 	mat4 proj = glm::perspectiveFov(45.0f, float(framebuf_width), float(framebuf_height), .001f, 100.f);
 	vec2 framebufferSize = vec2{ framebuf_width, framebuf_height };
 
-	ivec2 waterMapSize = ivec2{ 1024 };
-	ivec2 topViewSize  = ivec2{ 1024 };
-
-	// create framebuffers
-	Framebuffer backgroundFramebuffer = make_framebuffer(framebuf_width, framebuf_height);
-	Framebuffer waterFramebuffer      = make_framebuffer(framebuf_width, framebuf_height);
-	Framebuffer waterMapFramebuffer   = make_framebuffer(waterMapSize.x, waterMapSize.y);
-	Framebuffer topFramebuffer        = make_framebuffer(topViewSize.x, topViewSize.y);
+	ivec2 waterMapSize = ivec2(int(settings.water_map_size));
+	ivec2 topViewSize  = ivec2(int(settings.top_view_size ));
 
-	// textures
-	GLuint noise_normal_tex = import_texture("content/textures/noise_normal.jpg");
-	GLuint caustic_tex = import_texture("content/textures/caustic.png");
-	GLuint debug_tex   = import_texture("content/textures/ground.png");
-	GLuint noise_tex   = import_texture("content/textures/noise.png");
-	GLuint subsurf_tex = create_subsurf_texture();
-	GLuint skyCubemap  = createCubemap();
+	// what the combine pass draws to, the window unless headless
+	Framebuffer outputFramebuffer = {};
+	if (settings.headless) outputFramebuffer = make_framebuffer(framebuf_width, framebuf_height);
 
 	vec3 light_pos  = { 0, 1, 0 };
 	mat4 light_proj = glm::ortho(-1.0, 1.0, -1.0, 1.0);
 	mat4 light_view = glm::lookAt(light_pos, { 0, -1, 0 }, { 0, 0, 1 });
 
-	int terrainSize = 200;
+	int terrainSize = settings.terrain_size;
 	Mesh ground = {}; init(ground, terrainSize);
-	Mesh water  = {}; init(water , terrainSize, true);
+	Mesh water  = {}; init(water , terrainSize, true, water_state_format);
+	asset_loader_update(assets);
+
+	// camera centred levels instead of the whole grid, pays off once terrainSize is well past CLIPMAP_RESOLUTION
+	bool clipmap_lod = settings.clipmap_lod;
+	Clipmap clipmap = {};
+	if (clipmap_lod) init(clipmap);
+
+	// otherwise chunks outside the view of a pass get culled on the gpu
+	Mesh_Chunks ground_chunks = {}; init(ground_chunks, ground);
+	Mesh_Chunks water_chunks  = {}; init(water_chunks , water );
+	mesh_chunks_find_bounds(ground_chunks, ground);
+	asset_loader_update(assets);
+
+	// only wet tiles that are still moving get simulated, unless steps are done several per dispatch.
+	// the implicit integrators take WATER_IMPLICIT_STEP_MULTIPLE times longer steps over the whole grid
+	uint water_temporal_steps = settings.temporal_steps;
+	Water_Integrator water_integrator = settings.integrator;
+	Water_Simulation water_sim = {}; init(water_sim, water, ground, true, water_temporal_steps, water_integrator);
+
+	// cells along the edge that absorb waves, 0 lets them bounce off it
+	uint water_sponge_width = settings.sponge_width;
+	water_simulation_set_sponge(water_sim, water_sponge_width);
+	asset_loader_update(assets);
+
+	// open water : an fft ocean streams into the water mesh instead of running the wave solver
+	bool water_ocean = settings.water_ocean;
+	Thread_Pool ocean_pool = {};
+	Ocean ocean = {};
+	if (water_ocean)
+	{
+		init(&ocean_pool);
+		init(ocean, water, 256, &ocean_pool, vec2(10, 4), settings.seed);
+	}
+
+	// flooding & rivers : water with mass that runs over the terrain instead of the wave solver
+	bool water_shallow = settings.water_shallow;
+	Shallow_Water shallow_water = {};
+	Shallow_Water_CPU shallow_water_cpu = {};
+	if (water_shallow)
+	{
+		init(shallow_water, water, ground);
+		init(shallow_water_cpu, water.mesh_size + 1, ground.positions);
+	}
+
+	// reference solver for checking the gpu simulation (press C)
+	Water_CPU water_cpu = {}; init(water_cpu, water.mesh_size + 1);
+	water_read_terrain(water_cpu, ground.positions);
+	water_set_sponge(water_cpu, water_sponge_width);
+	asset_loader_update(assets);
+
+	Water_Implicit_CPU water_implicit_cpu = {};
+	if (water_integrator != WATER_EXPLICIT) init(water_implicit_cpu, water_cpu, water_integrator);
+
+	// the wave solver's water under dry tiles is hidden by the terrain, the ocean & shallow water can go anywhere
+	GLuint water_wet_mask = (water_ocean || water_shallow) ? 0 : water_sim.tile_wet;
+
+	// gpu time per pass (press P for the rolling stats), every frame goes to the files too when exporting
+	char gpu_timings_csv [256] = {};
+	char gpu_timings_json[256] = {};
+	if (settings.gpu_timings)
+	{
+		snprintf(gpu_timings_csv , sizeof(gpu_timings_csv ), "%s.csv" , settings.gpu_timings);
+		snprintf(gpu_timings_json, sizeof(gpu_timings_json), "%s.json", settings.gpu_timings);
+	}
+
+	const char* gpu_pass_labels[NUM_GPU_PASSES] = { "water simulation", "water-map", "top-view", "sky", "ground", "water", "combine" };
+	Gpu_Timers gpu_timers = {};
+	init(gpu_timers, gpu_pass_labels, NUM_GPU_PASSES,
+		settings.gpu_timings ? gpu_timings_csv : NULL, settings.gpu_timings ? gpu_timings_json : NULL);
+
+	Uniform_Buffers uniform_buffers = {}; init(uniform_buffers, NUM_RENDER_VIEWS);
+
+	// the passes of a frame & their render targets, the pass ids are their gpu timers
+	Render_Graph graph = {};
+
+	uint output        = render_graph_import_framebuffer(graph, "output", outputFramebuffer.id, framebuf_width, framebuf_height);
+	uint water_state   = render_graph_import_buffer(graph, "water state", !water_ocean); // the ocean is copied in, not computed
+	uint water_map     = render_graph_texture(graph, "water-map color"  , waterMapSize.x, waterMapSize.y, GL_RGBA8);
+	uint water_map_z   = render_graph_texture(graph, "water-map depth"  , waterMapSize.x, waterMapSize.y, GL_DEPTH_COMPONENT32);
+	uint top_view      = render_graph_texture(graph, "top-view color"   , topViewSize.x , topViewSize.y , GL_RGBA8);
+	uint top_view_z    = render_graph_texture(graph, "top-view depth"   , topViewSize.x , topViewSize.y , GL_DEPTH_COMPONENT32);
+	uint background    = render_graph_texture(graph, "background color" , framebuf_width, framebuf_height, GL_RGBA8);
+	uint background_z  = render_graph_texture(graph, "background depth" , framebuf_width, framebuf_height, GL_DEPTH_COMPONENT32);
+	uint water_color   = render_graph_texture(graph, "water color"      , framebuf_width, framebuf_height, GL_RGBA8);
+	uint water_color_z = render_graph_texture(graph, "water depth"      , framebuf_width, framebuf_height, GL_DEPTH_COMPONENT32);
+
+	// the water is drawn straight from the state buffers
+	uint pass = render_graph_pass(graph, "water-map", PASS_WATER_MAP);
+	render_graph_read (graph, pass, water_state, GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+	render_graph_write(graph, pass, water_map);
+	render_graph_write(graph, pass, water_map_z);
+
+	pass = render_graph_pass(graph, "top-view", PASS_TOP_VIEW);
+	render_graph_write(graph, pass, top_view);
+	render_graph_write(graph, pass, top_view_z);
+
+	pass = render_graph_pass(graph, "sky", PASS_SKY);
+	render_graph_write(graph, pass, background);
+	render_graph_write(graph, pass, background_z);
+
+	pass = render_graph_pass(graph, "ground", PASS_GROUND);
+	render_graph_read (graph, pass, water_map_z);
+	render_graph_read (graph, pass, water_map);
+	render_graph_write(graph, pass, background);
+	render_graph_write(graph, pass, background_z);
+
+	pass = render_graph_pass(graph, "water", PASS_WATER);
+	render_graph_read (graph, pass, water_state, GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+	render_graph_read (graph, pass, background);
+	render_graph_read (graph, pass, background_z);
+	render_graph_read (graph, pass, top_view_z);
+	render_graph_write(graph, pass, water_color);
+	render_graph_write(graph, pass, water_color_z);
+
+	pass = render_graph_pass(graph, "combine", PASS_COMBINE);
+	render_graph_read (graph, pass, background);
+	render_graph_read (graph, pass, background_z);
+	render_graph_read (graph, pass, water_color);
+	render_graph_read (graph, pass, water_color_z);
+	render_graph_write(graph, pass, output);
+
+	compile(graph);
 
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClearDepth(1.0f);
 	glEnable(GL_DEPTH_TEST);
 
+	asset_loader_finish(assets);
+	file_reader_release(); // everything loaded from the files is on the gpu by now
+	program_cache_print();
+	end(startup_zone);
+
 	Timer timer = {};
 	timer.begin_frame();
 
 	float dt = 1.f / 60;
 
-	while (!glfwWindowShouldClose(window.instance))
+	for (uint frame = 0; !glfwWindowShouldClose(window.instance); frame++)
 	{
+		PROFILE_SCOPE("frame");
+
+		if (settings.headless && frame == settings.num_frames) break;
+
+		Profile_Zone input_zone("swap & input");
 		update_window(window);
-		update_mouse(&mouse, window);
-		update_keyboard(&keys, window);
+		if (!settings.headless)
+		{
+			update_mouse(&mouse, window);
+			update_keyboard(&keys, window);
+		}
+		end(input_zone);
 
 		if (keys.W.is_pressed) camera_update_pos(&camera, DIR_FORWARD , 1/80.f);
 		if (keys.S.is_pressed) camera_update_pos(&camera, DIR_BACKWARD, 1/80.f);
 		if (keys.A.is_pressed) camera_update_pos(&camera, DIR_LEFT    , 1/80.f);
 		if (keys.D.is_pressed) camera_update_pos(&camera, DIR_RIGHT   , 1/80.f);
 
+		if (settings.camera_path != CAMERA_PATH_NONE)
+			camera_follow_path(&camera, settings.camera_path, settings.num_frames ? frame / float(settings.num_frames) : 0);
+
 		camera_update_dir(&camera, mouse.dx, mouse.dy, dt);
 
 		if (keys.ESC.is_pressed) break;
 
-		static float water_timer = 0; water_timer += dt;
+		if (keys.P.is_pressed && !keys.P.was_pressed) gpu_timers_print(gpu_timers);
 
+		gpu_timers_begin_frame(gpu_timers);
+		gpu_timer_begin(gpu_timers, PASS_WATER_SIMULATION);
+		Profile_Zone update_zone("water update");
+
+		if (water_ocean)
+		{
+			water_sim.time += dt;
+			ocean_update(ocean, water, water_sim.time);
+		}
+		else if (water_shallow)
+		{
+			if (keys.C.is_pressed && !keys.C.was_pressed)
+				shallow_water_compare(shallow_water, shallow_water_cpu, water, ground, shallow_water.substep_dt, shallow_water.time);
+
+			shallow_water_update(shallow_water, water, ground, dt);
+			water_sim.time = shallow_water.time;
+		}
+		else
 		{ // water simulation
-			int dimension = water.mesh_size + 1;
-			
-			glUseProgram(water_sim_comp.id);
+			glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, textures[APP_TEXTURE_NOISE]);
 
-			glUniform1i(0, dimension  );
-			glUniform1f(1, dt         );
-			glUniform1f(2, water_timer);
-			glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, noise_tex);
+			if (keys.C.is_pressed && !keys.C.was_pressed)
+			{
+				if (water_integrator != WATER_EXPLICIT)
+					water_simulation_compare_implicit(water_sim, water_cpu, water_implicit_cpu, water, water_sim.substep_dt, water_sim.time);
+				else
+					water_simulation_compare(water_sim, water_cpu, water, ground, water_sim.substep_dt, water_sim.time);
+			}
 
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, water.positions[0] );
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, water.positions[1] );
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, water.normals      );
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, ground.positions[0]);
+			// temporal blocking vs single steps (press T)
+			if (keys.T.is_pressed && !keys.T.was_pressed)
+				water_simulation_compare_temporal(water_sim, water, ground, water_sim.substep_dt, water_sim.time);
 
-			glDispatchCompute(dimension, dimension, 1);
+			water_simulation_update(water_sim, water, ground, dt);
 		}
 
+		end(update_zone);
+		gpu_timer_end(gpu_timers, PASS_WATER_SIMULATION);
+
+		if (!clipmap_lod) mesh_chunks_find_bounds(water_chunks, water);
+
 		// ----- RENDER FUNCTION ---- //
 
+		Profile_Zone render_zone("render");
+
 		mat4 view = lookAt(camera.position, camera.position + camera.front, camera.up);
 
+		// the water & the caustics on the ground both move with the simulated time
+		frame_uniforms_set(uniform_buffers, view, proj, light_view, light_proj, framebufferSize, water_sim.time, dt);
+		pass_uniforms_set (uniform_buffers, VIEW_CAMERA, proj * view);
+		pass_uniforms_set (uniform_buffers, VIEW_TOP   , light_proj * light_view);
+		uniform_buffers_upload(uniform_buffers);
+
 		glEnable(GL_DEPTH_TEST);
 		glEnable(GL_CULL_FACE);
 
-		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-
-		// Render water-map
+		for (uint i = 0; i < graph.num_scheduled; i++)
 		{
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, waterMapFramebuffer.id);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			uint pass = render_graph_begin_pass(graph, i);
+			gpu_timer_begin(gpu_timers, pass);
 
-			bind(simple_water_shader);
+			if (pass == PASS_WATER_MAP)
 			{
-				set_vec4(simple_water_shader, "world_position", vec4(0));
-				set_mat4(simple_water_shader, "proj_view"     , light_proj * light_view);
-
-				glViewport(0, 0, waterMapSize.x, waterMapSize.y);
-				render(water);
-				glViewport(0, 0, int(framebufferSize.x), int(framebufferSize.y));
-			}
+				bind(simple_water_shader);
+				uniform_buffers_bind_pass(uniform_buffers, VIEW_TOP);
 
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-		}
+				set_vec4(0, vec4(0));             // world_position
+				set_int (2, water.mesh_size + 1); // StateDimension
 
-		// Render top-view
-		{
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, topFramebuffer.id);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				if (clipmap_lod) render(clipmap, water, camera.position);
+				else render(water_chunks, simple_water_shader, water, light_proj * light_view, water_wet_mask, water_sim.tiles_per_side);
+			}
 
-			bind(simple_water_shader);
+			if (pass == PASS_TOP_VIEW)
 			{
-				set_vec4(simple_water_shader, "world_position", vec4(0));
-				set_mat4(simple_water_shader, "proj_view", light_proj * light_view);
+				bind(simple_water_shader);
+				uniform_buffers_bind_pass(uniform_buffers, VIEW_TOP);
 
-				glViewport(0, 0, topViewSize.x, topViewSize.y);
-				render(ground);
-				glViewport(0, 0, int(framebufferSize.x), int(framebufferSize.y));
-			}
+				set_vec4(0, vec4(0)); // world_position
+				set_int (2, 0);       // StateDimension
 
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-		}
+				if (clipmap_lod) render(clipmap, ground, camera.position);
+				else render(ground_chunks, simple_water_shader, ground, light_proj * light_view);
+			}
 
-		// render skybox
-		{
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, backgroundFramebuffer.id);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			bind(sky_shader);
+			if (pass == PASS_SKY)
 			{
-				set_mat4(sky_shader, "inverse_view_proj", glm::inverse(proj * view));
-
+				bind(sky_shader);
 				glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_CUBE_MAP, skyCubemap);
 
 				glDisable(GL_DEPTH_TEST);
@@ -208,83 +564,341 @@ int main()
 				glEnable(GL_DEPTH_TEST);
 			}
 
-			// Render ground
-			bind(ground_shader);
+			if (pass == PASS_GROUND)
 			{
-				set_vec4  (ground_shader, "world_position"     , vec4(0) );
-				set_mat4  (ground_shader, "proj_view"          , proj * view);
-				set_mat3  (ground_shader, "NormalMatrix"       , mat3(1) );
-				set_mat4  (ground_shader, "WaterMapProjectionMatrix" , light_proj);
-				set_mat4  (ground_shader, "WaterMapViewMatrix" , light_view );
-				set_float (ground_shader, "TextureScale"       , 24.0f      );
-				set_float (ground_shader, "Time"               , water_timer);
-
-				bind_texture(waterMapFramebuffer.depth, 0);
-				bind_texture(waterMapFramebuffer.color, 1);
-				bind_texture(debug_tex                , 2);
-				bind_texture(noise_normal_tex         , 3);
-				bind_texture(caustic_tex              , 4);
+				bind(ground_shader);
+				uniform_buffers_bind_pass(uniform_buffers, VIEW_CAMERA);
+
+				set_vec4 (0, vec4(0)); // world_position
+				set_mat3 (3, mat3(1)); // NormalMatrix
+				set_float(6, 24.0f  ); // TextureScale
+
+				bind_texture(render_graph_texture_id(graph, water_map_z), 0);
+				bind_texture(render_graph_texture_id(graph, water_map  ), 1);
+				bind_texture(textures[APP_TEXTURE_GROUND      ], 2);
+				bind_texture(textures[APP_TEXTURE_NOISE_NORMAL], 3);
+				bind_texture(textures[APP_TEXTURE_CAUSTIC     ], 4);
 				glActiveTexture(GL_TEXTURE5); glBindTexture(GL_TEXTURE_1D, subsurf_tex);
 
-				render(ground);
+				if (clipmap_lod) render(clipmap, ground, camera.position);
+				else render(ground_chunks, ground_shader, ground, proj * view);
 			}
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+			if (pass == PASS_WATER)
+			{
+				bind(water_shader);
+
+				set_vec4(0, vec4(0)            ); // world_position
+				set_mat3(3, mat3(1.f)          ); // NormalMatrix
+				set_int (9, water.mesh_size + 1); // StateDimension
+
+				bind_texture(render_graph_texture_id(graph, background  ), 0);
+				bind_texture(render_graph_texture_id(graph, background_z), 1);
+				bind_texture(render_graph_texture_id(graph, top_view_z  ), 2);
+				bind_texture(textures[APP_TEXTURE_NOISE       ], 3);
+				bind_texture(textures[APP_TEXTURE_NOISE_NORMAL], 4);
+				bind_texture(subsurf_tex                       , 5);
+				glActiveTexture(GL_TEXTURE6); glBindTexture(GL_TEXTURE_CUBE_MAP, skyCubemap);
+
+				glDisable(GL_CULL_FACE);
+				if (clipmap_lod) render(clipmap, water, camera.position);
+				else render(water_chunks, water_shader, water, proj * view, water_wet_mask, water_sim.tiles_per_side);
+				glEnable(GL_CULL_FACE);
+			}
+
+			if (pass == PASS_COMBINE)
+			{
+				bind(combine_shader);
+
+				bind_texture(render_graph_texture_id(graph, background   ), 0);
+				bind_texture(render_graph_texture_id(graph, background_z ), 1);
+				bind_texture(render_graph_texture_id(graph, water_color  ), 2);
+				bind_texture(render_graph_texture_id(graph, water_color_z), 3);
+
+				glDisable(GL_DEPTH_TEST);
+				glBindVertexArray(quad.VAO);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+				glBindVertexArray(0);
+			}
+
+			gpu_timer_end(gpu_timers, pass);
+			render_graph_end_pass();
 		}
+		end(render_zone);
+
+		// the same steps on every machine, however long the frames take
+		if (settings.headless) continue;
+
+		dt = (float)timer.end_frame();
+
+		// multigrid cycles of the last implicit step
+		char title[64] = {};
+		if (water_integrator != WATER_EXPLICIT) snprintf(title, 64, "%04f | %u cycles", 1.f / dt, water_sim.multigrid.cycles);
+		else                                    snprintf(title, 64, "%04f", 1.f / dt);
+		glfwSetWindowTitle(window.instance, title);
+	}
 
-		// Render water
-		bind(water_shader);
+	if (settings.headless)
+	{
+		gpu_timers_flush(gpu_timers);
+		print("%s | terrain %u | water-map %u | top-view %u | %ux%u\n", settings.label, settings.terrain_size,
+			settings.water_map_size, settings.top_view_size, settings.framebuffer_width, settings.framebuffer_height);
+	}
+
+	gpu_timers_print(gpu_timers);
+
+	if (settings.report)
+	{
+		float total = 0;
+		for (uint i = 0; i < NUM_GPU_PASSES; i++)
 		{
-			set_vec4 (water_shader, "world_position"      , vec4(0)        );
-			set_mat4 (water_shader, "ViewMatrix"          , view           );
-			set_mat4 (water_shader, "ProjectionMatrix"    , proj           );
-			set_mat3 (water_shader, "NormalMatrix"        , mat3(1.f)      );
-			set_mat4 (water_shader, "TopViewMatrix"       , light_view     );
-			set_mat4 (water_shader, "TopProjectionMatrix" , light_proj     );
-			set_vec2 (water_shader, "FramebufferSize"     , framebufferSize);
-			set_float(water_shader, "DeltaTime"           , dt             );
-			set_float(water_shader, "Time"                , glfwGetTime()  );
-
-			bind_texture(backgroundFramebuffer.color, 0);
-			bind_texture(backgroundFramebuffer.depth, 1);
-			bind_texture(topFramebuffer.depth , 2);
-			bind_texture(noise_tex            , 3);
-			bind_texture(noise_normal_tex     , 4);
-			bind_texture(subsurf_tex          , 5);
-			glActiveTexture(GL_TEXTURE6); glBindTexture(GL_TEXTURE_CUBE_MAP, skyCubemap);
-
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, waterFramebuffer.id);
-
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-			glDisable(GL_CULL_FACE);
-			render(water);
-			glEnable(GL_CULL_FACE);
-
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+			Gpu_Timer_Stats stats = gpu_timer_stats(gpu_timers, i);
+			write_report(settings.report, settings, gpu_pass_labels[i], stats.min, stats.avg, stats.p99);
+			total += stats.avg;
 		}
+		write_report(settings.report, settings, "total", 0, total, 0);
+		fflush(settings.report);
+	}
 
-		// Combine framebuffer
-		bind(combine_shader);
-		{
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	free(gpu_timers);
+	free(uniform_buffers);
+	free(graph);
+
+	if (water_integrator != WATER_EXPLICIT) free(water_implicit_cpu);
+	if (clipmap_lod) free(clipmap);
+	free(ground_chunks);
+	free(water_chunks);
+
+	if (water_shallow)
+	{
+		free(shallow_water);
+		free(shallow_water_cpu);
+	}
+
+	if (water_ocean)
+	{
+		free(ocean);
+		shutdown(&ocean_pool);
+	}
+
+	free(water_cpu);
 
-			bind_texture(backgroundFramebuffer.color, 0);
-			bind_texture(backgroundFramebuffer.depth, 1);
-			bind_texture(waterFramebuffer.color     , 2);
-			bind_texture(waterFramebuffer.depth     , 3);
+	// the context goes with the window, taking every gl object of the run with it
+	glfwTerminate();
+}
 
-			glDisable(GL_DEPTH_TEST);
+// "a,b,c" into values, returns how many there were
+uint parse_list(const char* list, uint* values, uint max_values)
+{
+	uint n = 0;
+	while (*list && n < max_values)
+	{
+		char* end = NULL;
+		uint value = strtoul(list, &end, 10);
+		if (end == list) break;
+
+		values[n++] = value;
+		if (*end != ',') break;
+		list = end + 1;
+	}
+	return n;
+}
+
+// "1280x720,1920x1080" into widths & heights
+uint parse_resolutions(const char* list, uint* widths, uint* heights, uint max_values)
+{
+	uint n = 0;
+	while (*list && n < max_values)
+	{
+		char* end = NULL;
+		widths [n] = strtoul(list, &end, 10);
+		if (*end != 'x') break;
+
+		heights[n++] = strtoul(end + 1, &end, 10);
+		if (*end != ',') break;
+		list = end + 1;
+	}
+	return n;
+}
+
+#define BENCH_MAX_SWEEP 8 // values per swept setting
+
+// --bench cpu : the cpu solver alone, no window. scalar vs simd rows on one thread, then simd on 1, 2, 4 .. max_threads
+void bench_water_cpu(const uint* terrain_sizes, uint num_terrain_sizes, uint num_steps, uint max_threads)
+{
+	for (uint i = 0; i < num_terrain_sizes; i++)
+	{
+		uint dimension = terrain_sizes[i] + 1; // a cell per vertex, like the one run() steps
 
-			glBindVertexArray(quad.VAO);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
-			glBindVertexArray(0);
+		water_benchmark(dimension, num_steps, false);
+		water_benchmark(dimension, num_steps, true);
+		water_benchmark_scaling(dimension, num_steps, max_threads);
+	}
+}
+
+// --bench fft : 1D plans from 64 to 4096, then a 1024^2 ifft2D on one thread & on the pool
+void bench_fft(uint max_threads)
+{
+	fft_benchmark();
+	fft2D_benchmark(1024);
+
+	Thread_Pool pool = {};
+	init(&pool, max_threads, true);
+	fft2D_benchmark(1024, &pool);
+	shutdown(&pool);
+}
+
+/* -- benchmarks --
+
+	realtimewater --bench --label before --frames 600 --path orbit --seed 1 --terrain 128,256,512
+		--water-map 512,1024 --top-view 1024 --resolution 1280x720,1920x1080 --report bench.csv
+
+	every combination of the swept settings is a run, all of them append to the same report.
+	--bench cpu times the cpu water solver for every --terrain size instead, --frames steps each (200 by default),
+	scalar & simd on one thread, then on 1, 2, 4 .. --threads N threads (every core by default).
+	--bench fft times the fft plans & the 2d transforms on one thread & on --threads N
+	--water waves|ocean|shallow picks the water. on a machine without a display or gpu :
+	xvfb-run -s "-screen 0 1920x1080x24" with LIBGL_ALWAYS_SOFTWARE=1 renders through mesa llvmpipe
+
+	the wave solver, in the app or in the benchmarks :
+	--integrator explicit|be|cn   explicit steps, or implicit ones solved with multigrid (backward euler, crank-nicolson)
+	--temporal-steps N            N explicit steps per dispatch out of shared memory (press T to check them against single ones)
+	--sponge N                    the last N cells along the edge absorb the waves instead of reflecting them
+
+	--clipmap draws the water & the ground as clipmap levels around the camera instead of culled chunks
+
+	realtimewater --trace [path] records the cpu zones of startup & every frame (or of every run with --bench),
+	written on exit as a chrome trace to path, cpu_trace.json by default. open it in chrome://tracing or perfetto
+
+	realtimewater --gpu-timings timings writes every frame's gpu pass times to timings.csv & timings.json,
+	in the app or with --bench (every run of a sweep overwrites them)
+
+	realtimewater --bake converts content/textures into the .tex files startup prefers, see baked_textures.h
+	realtimewater --pack puts everything startup reads into content.pack, the only file to ship. see files.h.
+	delete it (or --pack again) after editing anything in content/, it is read instead of content/ when it is there
+*/
+int main(int argc, char** argv)
+{
+	profiler_set_thread_name("main");
+
+	// cpu zones of the whole run (startup & every frame), written out as a chrome trace on exit
+	bool cpu_trace = false;
+	const char* trace_path = "cpu_trace.json";
+
+	Run_Settings settings = {};
+
+	bool bench = false;
+	const char* bench_mode = ""; // cpu or fft, frames of the app without one
+	uint bench_threads = 0;
+	const char* report_path = "bench_report.csv";
+
+	uint terrain_sizes  [BENCH_MAX_SWEEP] = { 128, 256, 512 }; uint num_terrain_sizes   = 3;
+	uint water_map_sizes[BENCH_MAX_SWEEP] = { 1024 };          uint num_water_map_sizes = 1;
+	uint top_view_sizes [BENCH_MAX_SWEEP] = { 1024 };          uint num_top_view_sizes  = 1;
+	uint widths [BENCH_MAX_SWEEP] = { 1920 };
+	uint heights[BENCH_MAX_SWEEP] = { 1080 }; uint num_resolutions = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg   = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : "";
+
+		if (!strcmp(arg, "--clipmap")) { settings.clipmap_lod = true; continue; }
+		if (!strcmp(arg, "--bake"   )) { bake_textures(); return 0; }
+		if (!strcmp(arg, "--pack"   )) { pack_content (); return 0; }
+		if (!strcmp(arg, "--bench"))
+		{
+			bench = true;
+			if (*value && strncmp(value, "--", 2)) { bench_mode = value; i++; } // the mode is optional
+			continue;
+		}
+		if (!strcmp(arg, "--trace"))
+		{
+			cpu_trace = true;
+			if (*value && strncmp(value, "--", 2)) { trace_path = value; i++; } // the path is optional
+			continue;
 		}
 
-		char title[16] = {};
-		snprintf(title, 16, "%04f", 1.f / timer.end_frame());
-		glfwSetWindowTitle(window.instance, title);
+		if      (!strcmp(arg, "--frames"    )) settings.num_frames = strtoul(value, NULL, 10);
+		else if (!strcmp(arg, "--seed"      )) settings.seed       = strtoul(value, NULL, 10);
+		else if (!strcmp(arg, "--sponge"    )) settings.sponge_width = strtoul(value, NULL, 10);
+		else if (!strcmp(arg, "--temporal-steps")) settings.temporal_steps = strtoul(value, NULL, 10);
+		else if (!strcmp(arg, "--threads"   )) bench_threads       = strtoul(value, NULL, 10);
+		else if (!strcmp(arg, "--label"     )) settings.label      = value;
+		else if (!strcmp(arg, "--report"    )) report_path         = value;
+		else if (!strcmp(arg, "--gpu-timings")) settings.gpu_timings = value;
+		else if (!strcmp(arg, "--terrain"   )) num_terrain_sizes   = parse_list(value, terrain_sizes  , BENCH_MAX_SWEEP);
+		else if (!strcmp(arg, "--water-map" )) num_water_map_sizes = parse_list(value, water_map_sizes, BENCH_MAX_SWEEP);
+		else if (!strcmp(arg, "--top-view"  )) num_top_view_sizes  = parse_list(value, top_view_sizes , BENCH_MAX_SWEEP);
+		else if (!strcmp(arg, "--resolution")) num_resolutions     = parse_resolutions(value, widths, heights, BENCH_MAX_SWEEP);
+		else if (!strcmp(arg, "--path"))
+		{
+			if (!strcmp(value, "still"  )) settings.camera_path = CAMERA_PATH_STILL;
+			if (!strcmp(value, "orbit"  )) settings.camera_path = CAMERA_PATH_ORBIT;
+			if (!strcmp(value, "flyover")) settings.camera_path = CAMERA_PATH_FLYOVER;
+		}
+		else if (!strcmp(arg, "--water"))
+		{
+			settings.water_ocean   = !strcmp(value, "ocean"  );
+			settings.water_shallow = !strcmp(value, "shallow");
+		}
+		else if (!strcmp(arg, "--integrator"))
+		{
+			if (!strcmp(value, "explicit")) settings.integrator = WATER_EXPLICIT;
+			if (!strcmp(value, "be"      )) settings.integrator = WATER_BACKWARD_EULER;
+			if (!strcmp(value, "cn"      )) settings.integrator = WATER_CRANK_NICOLSON;
+		}
+		else { out("unknown argument '" << arg << "'"); continue; }
+
+		i++; // the value
 	}
 
-	glfwTerminate();
+	if (cpu_trace) profiler_start();
+
+	if (!bench)
+	{
+		run(settings);
+	}
+	else if (!strcmp(bench_mode, "cpu"))
+	{
+		bench_water_cpu(terrain_sizes, num_terrain_sizes, settings.num_frames ? settings.num_frames : 200, bench_threads);
+	}
+	else if (!strcmp(bench_mode, "fft"))
+	{
+		bench_fft(bench_threads);
+	}
+	else
+	{
+		settings.headless = true;
+		if (!settings.num_frames) settings.num_frames = 600;
+		if (settings.camera_path == CAMERA_PATH_NONE) settings.camera_path = CAMERA_PATH_ORBIT;
+
+		// appends, so runs of different builds end up side by side
+		FILE* report = fopen(report_path, "a+");
+		if (!report) { out("ERROR : can't write '" << report_path << "'"); return 1; }
+
+		fseek(report, 0, SEEK_END);
+		if (ftell(report) == 0) write_report_header(report);
+		settings.report = report;
+
+		for (uint t = 0; t < num_terrain_sizes  ; t++) {
+		for (uint w = 0; w < num_water_map_sizes; w++) {
+		for (uint v = 0; v < num_top_view_sizes ; v++) {
+		for (uint r = 0; r < num_resolutions    ; r++)
+		{
+			settings.terrain_size       = terrain_sizes  [t];
+			settings.water_map_size     = water_map_sizes[w];
+			settings.top_view_size      = top_view_sizes [v];
+			settings.framebuffer_width  = widths [r];
+			settings.framebuffer_height = heights[r];
+
+			run(settings);
+		} } } }
+
+		fclose(report);
+	}
+
+	if (cpu_trace) profiler_write_trace(trace_path);
+
 	return 0;
-}
\ No newline at end of file
+}
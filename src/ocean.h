@@ -0,0 +1,242 @@
+// statistical open water (tessendorf, "simulating ocean water") instead of the local wave solver.
+// a phillips spectrum is seeded once, advanced in frequency space & inverse transformed every frame.
+// the patch is periodic, so the water mesh samples it tiled : the cost depends on N, not on how much water is visible
+
+#include "external/GLM/gtc/packing.hpp" // packHalf2x16
+
+#include <complex>
+typedef std::complex<double> Complex;
+
+#include <proprietary/fft.h>
+
+// like the one in mathematics.h, but n & seed pick the sample so a spectrum can be seeded
+Complex gaussian_random_complex(uint n, uint seed)
+{
+	float x1, x2, w;
+	n *= 64; // room for the rejected samples
+	do {
+		x1 = (noise_chance(n++, seed) * 2) - 1;
+		x2 = (noise_chance(n++, seed) * 2) - 1;
+		w = x1 * x1 + x2 * x2;
+	} while (w > 1.f || w == 0.f);
+	w = sqrt((-2.f * log(w)) / w);
+	return Complex(x1 * w, x2 * w);
+}
+
+#define OCEAN_GRAVITY 9.81f
+
+struct Ocean
+{
+	uint  N;          // fft size, power of 2
+	float patch_size; // meters in one period of the patch
+	float tiles;      // periods across the water mesh
+	float choppiness; // scale of the horizontal displacement, 0 = plain height field
+
+	Complex* h0;       // [N * N] h0(k)
+	Complex* h0_minus; // [N * N] conj(h0(-k))
+	float*   omega;    // [N * N] deep water dispersion sqrt(g |k|)
+
+	// real fields packed in pairs (a + i b), so 3 inverse transforms give all 6
+	Complex* height_velocity; // h & dh/dt
+	Complex* displacement;    // dx & dz
+	Complex* slope;           // dh/dx & dh/dz
+
+	FFT_Plan plan;
+	Thread_Pool* pool;
+
+	// one entry per water mesh vertex, in mesh units
+	uint  dimension;
+	byte* state;   // (height, velocity) in the mesh's state format
+	vec4* normals;
+	vec2* offsets; // choppy (dx, dz)
+};
+
+// wind_speed in m/s, amplitude is the phillips constant
+float phillips_spectrum(vec2 k, vec2 wind_direction, float wind_speed, float amplitude)
+{
+	float k2 = glm::dot(k, k);
+	if (k2 < 1e-12f) return 0;
+
+	float L = (wind_speed * wind_speed) / OCEAN_GRAVITY; // largest wave the wind makes
+	float l = L / 1000;                                  // waves much smaller than this are damped
+
+	float k_dot_w = glm::dot(glm::normalize(k), wind_direction);
+
+	return amplitude * (exp(-1 / (k2 * L * L)) / (k2 * k2)) * (k_dot_w * k_dot_w) * exp(-k2 * l * l);
+}
+
+// wave number of fft index n : 0 .. N/2 - 1, then -N/2 .. -1
+int ocean_wave_index(uint n, uint N) { return n < N / 2 ? (int)n : (int)n - (int)N; }
+
+vec2 ocean_wave_vector(Ocean& ocean, uint row, uint column)
+{
+	float dk = TWOPI / ocean.patch_size;
+	return vec2(ocean_wave_index(column, ocean.N), ocean_wave_index(row, ocean.N)) * dk; // (x, z)
+}
+
+Complex times_i(Complex z) { return Complex(-z.imag(), z.real()); }
+
+void init(Ocean& ocean, Mesh& water, uint N = 256, Thread_Pool* pool = NULL, vec2 wind = vec2(10, 4), uint seed = 0,
+	float patch_size = 64, float tiles = 2, float choppiness = 1, float amplitude = 2e-3f)
+{
+	ocean.N          = N;
+	ocean.patch_size = patch_size;
+	ocean.tiles      = tiles;
+	ocean.choppiness = choppiness;
+	ocean.pool       = pool;
+
+	ocean.h0              = Alloc(Complex, N * N);
+	ocean.h0_minus        = Alloc(Complex, N * N);
+	ocean.omega           = Alloc(float  , N * N);
+	ocean.height_velocity = Alloc(Complex, N * N);
+	ocean.displacement    = Alloc(Complex, N * N);
+	ocean.slope           = Alloc(Complex, N * N);
+
+	init(&ocean.plan, N);
+
+	// h0 = (xi_r + i xi_i) * sqrt(P(k) / 2) * dk, xi ~ N(0, 1)
+	float wind_speed = glm::length(wind);
+	vec2  wind_direction = wind / wind_speed;
+	float dk = TWOPI / patch_size;
+
+	for (uint row = 0; row < N; row++) {
+	for (uint column = 0; column < N; column++)
+	{
+		uint i = (row * N) + column;
+		vec2 k = ocean_wave_vector(ocean, row, column);
+
+		ocean.omega[i] = sqrt(OCEAN_GRAVITY * glm::length(k));
+
+		// the nyquist row & column have no mirror image, they would leak between the packed fields
+		if (row == N / 2 || column == N / 2) continue;
+
+		float P = phillips_spectrum(k, wind_direction, wind_speed, amplitude);
+		ocean.h0[i] = gaussian_random_complex(i, seed) * (double)(sqrt(P * 0.5f) * dk);
+	} }
+
+	for (uint row = 0; row < N; row++) {
+	for (uint column = 0; column < N; column++)
+	{
+		uint mirror = (((N - row) % N) * N) + ((N - column) % N);
+		ocean.h0_minus[(row * N) + column] = conj(ocean.h0[mirror]);
+	} }
+
+	uint D = water.mesh_size + 1;
+	ocean.dimension = D;
+	ocean.state   = Alloc(byte, state_size(water.state_format) * D * D);
+	ocean.normals = Alloc(vec4, D * D);
+	ocean.offsets = Alloc(vec2, D * D);
+
+	// the wave solver doesn't need horizontal motion, so the buffer only exists with an ocean
+	if (!water.displacement)
+	{
+		glGenBuffers(1, &water.displacement);
+		glBindBuffer(GL_ARRAY_BUFFER, water.displacement);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * D * D, ocean.offsets, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		for (uint i = 0; i < 2; i++) setAttribPointer(water.VAO[i], Attrib::Displacement, water.displacement, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+	}
+}
+void free(Ocean& ocean)
+{
+	free(ocean.h0);
+	free(ocean.h0_minus);
+	free(ocean.omega);
+	free(ocean.height_velocity);
+	free(ocean.displacement);
+	free(ocean.slope);
+	free(ocean.state);
+	free(ocean.normals);
+	free(ocean.offsets);
+	free(&ocean.plan);
+	ocean = {};
+}
+
+// h(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t) & everything derived from it
+void ocean_spectrum(Ocean& ocean, float time)
+{
+	uint N = ocean.N;
+
+	for (uint row = 0; row < N; row++) {
+	for (uint column = 0; column < N; column++)
+	{
+		uint i = (row * N) + column;
+		vec2 k = ocean_wave_vector(ocean, row, column);
+		float k_length = glm::length(k);
+
+		Complex phase = std::polar(1.0, (double)(ocean.omega[i] * time));
+		Complex h     = (ocean.h0[i] * phase) + (ocean.h0_minus[i] * conj(phase));
+		Complex h_dt  = times_i((ocean.h0[i] * phase) - (ocean.h0_minus[i] * conj(phase))) * (double)ocean.omega[i];
+
+		// D(k) = -i k / |k| h(k), slope = i k h(k)
+		Complex ih = times_i(h);
+		Complex dx = k_length > 0 ? -ih * (double)(k.x / k_length) : Complex(0);
+		Complex dz = k_length > 0 ? -ih * (double)(k.y / k_length) : Complex(0);
+
+		ocean.height_velocity[i] = h + times_i(h_dt);
+		ocean.displacement   [i] = dx + times_i(dz);
+		ocean.slope          [i] = (ih * (double)k.x) + times_i(ih * (double)k.y);
+	} }
+}
+
+// bilinear, wrapping around the periodic patch
+Complex ocean_sample(Ocean& ocean, Complex* field, float u, float v)
+{
+	uint N = ocean.N;
+	float x = u - floor(u / N) * N;
+	float y = v - floor(v / N) * N;
+
+	uint x0 = (uint)x % N, x1 = (x0 + 1) % N;
+	uint y0 = (uint)y % N, y1 = (y0 + 1) % N;
+	double fx = x - floor(x), fy = y - floor(y);
+
+	Complex top    = field[(y0 * N) + x0] * (1 - fx) + field[(y0 * N) + x1] * fx;
+	Complex bottom = field[(y1 * N) + x0] * (1 - fx) + field[(y1 * N) + x1] * fx;
+	return top * (1 - fy) + bottom * fy;
+}
+
+// evolves the spectrum to time, transforms it & uploads heights, normals & displacement into the water mesh
+void ocean_update(Ocean& ocean, Mesh& water, float time)
+{
+	PROFILE_SCOPE("ocean_update");
+
+	ocean_spectrum(ocean, time);
+
+	ifft2D(&ocean.plan, ocean.height_velocity, false, ocean.pool);
+	ifft2D(&ocean.plan, ocean.displacement   , false, ocean.pool);
+	ifft2D(&ocean.plan, ocean.slope          , false, ocean.pool);
+
+	uint D = ocean.dimension;
+	float meters_to_mesh = 1.f / (ocean.tiles * ocean.patch_size); // the mesh is 1 unit across
+	float cells_per_vertex = ocean.tiles * ocean.N / (D - 1);
+
+	vec2* state_full = (vec2*)ocean.state;
+	uint* state_half = (uint*)ocean.state;
+
+	// x/z follow the vertex order of create_mesh()
+	for (uint i = 0; i < D * D; i++)
+	{
+		float u = (i / D) * cells_per_vertex; // x
+		float v = (i % D) * cells_per_vertex; // z
+
+		Complex hv    = ocean_sample(ocean, ocean.height_velocity, u, v);
+		Complex dxdz  = ocean_sample(ocean, ocean.displacement   , u, v);
+		Complex slope = ocean_sample(ocean, ocean.slope          , u, v);
+
+		vec2 state = vec2(hv.real(), hv.imag()) * meters_to_mesh;
+		if (water.state_format == GL_RG16F) state_half[i] = glm::packHalf2x16(state);
+		else                                state_full[i] = state;
+
+		ocean.normals[i] = vec4(glm::normalize(vec3(-slope.real(), 1, -slope.imag())), 0);
+		ocean.offsets[i] = vec2(dxdz.real(), dxdz.imag()) * (ocean.choppiness * meters_to_mesh);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, water.state[water.current]);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, state_size(water.state_format) * D * D, ocean.state);
+	glBindBuffer(GL_ARRAY_BUFFER, water.normals);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vec4) * D * D, ocean.normals);
+	glBindBuffer(GL_ARRAY_BUFFER, water.displacement);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vec2) * D * D, ocean.offsets);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,193 @@
+// linked programs saved to disk with glGetProgramBinary & loaded back with glProgramBinary on the next launch,
+// so the driver doesn't compile every shader from source again. a program's file is named after a hash of its
+// sources, defines & the driver (vendor, renderer, version), so editing a shader or updating the driver misses.
+// a binary the driver rejects anyway is compiled from source & saved again
+
+#ifdef _WIN32
+#include <direct.h> // _mkdir
+#else
+#include <sys/stat.h> // mkdir
+#endif
+
+#define PROGRAM_CACHE_DIRECTORY "shader_cache"
+#define PROGRAM_CACHE_MAGIC     0x47525043 // "CPRG"
+
+struct Program_Cache_Header
+{
+	uint     magic;
+	GLenum   format; // of the binary, from glGetProgramBinary
+	uint     size;
+	uint64_t compile_ns; // how long it took from source, what a hit saves
+};
+
+struct Program_Cache
+{
+	bool disabled; // the driver has no binary formats
+	bool initialized;
+	uint64_t driver_hash;
+
+	uint hits, misses, rejected;
+	uint64_t load_ns;    // spent loading binaries
+	uint64_t compile_ns; // spent compiling sources
+	uint64_t saved_ns;   // compile times of the hits minus their load times
+};
+
+static Program_Cache global_program_cache;
+
+// fnv-1a
+uint64_t program_cache_hash(const void* data, uint64_t size, uint64_t hash = 14695981039346656037ull)
+{
+	const byte* bytes = (const byte*)data;
+	for (uint64_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void program_cache_init()
+{
+	Program_Cache& cache = global_program_cache;
+	cache.initialized = true;
+
+	GLint num_formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+	cache.disabled = (num_formats == 0);
+
+	const char* driver[] = {
+		(const char*)glGetString(GL_VENDOR),
+		(const char*)glGetString(GL_RENDERER),
+		(const char*)glGetString(GL_VERSION) };
+
+	cache.driver_hash = program_cache_hash(NULL, 0);
+	for (uint i = 0; i < 3; i++)
+		if (driver[i]) cache.driver_hash = program_cache_hash(driver[i], strlen(driver[i]) + 1, cache.driver_hash);
+
+#ifdef _WIN32
+	_mkdir(PROGRAM_CACHE_DIRECTORY);
+#else
+	mkdir(PROGRAM_CACHE_DIRECTORY, 0755);
+#endif
+}
+
+// sources in the order they are compiled, NULL ones (no defines) count as empty.
+// lengths like glShaderSource(), a negative one means the source ends with a 0
+uint64_t program_cache_key(const char** sources, const GLint* lengths, uint num_sources)
+{
+	if (!global_program_cache.initialized) program_cache_init();
+
+	uint64_t key = global_program_cache.driver_hash;
+	for (uint i = 0; i < num_sources; i++)
+	{
+		const char* source = sources[i] ? sources[i] : "";
+		size_t length = lengths[i] < 0 ? strlen(source) : lengths[i];
+
+		key = program_cache_hash(source, length, key);
+		key = program_cache_hash("", 1, key); // a 0 between them, so "ab" + "c" isn't "a" + "bc"
+	}
+	return key;
+}
+
+void program_cache_path(char* path, uint size, uint64_t key)
+{
+	snprintf(path, size, PROGRAM_CACHE_DIRECTORY "/%016llx.bin", (unsigned long long)key);
+}
+
+// true when program is linked from the cache, otherwise it still has to be compiled
+bool program_cache_load(GLuint program, uint64_t key, const char* name)
+{
+	Program_Cache& cache = global_program_cache;
+	if (cache.disabled) return false;
+
+	uint64_t begin = profiler_now();
+
+	char path[64] = {};
+	program_cache_path(path, sizeof(path), key);
+
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		cache.misses++;
+		print("shader cache miss   : %s\n", name);
+		return false;
+	}
+
+	Program_Cache_Header header = {};
+	byte* binary = NULL;
+
+	bool read = fread(&header, sizeof(header), 1, file) == 1 && header.magic == PROGRAM_CACHE_MAGIC;
+	if (read)
+	{
+		binary = Alloc(byte, header.size);
+		read = fread(binary, 1, header.size, file) == header.size;
+	}
+	fclose(file);
+
+	GLint linked = GL_FALSE;
+	if (read)
+	{
+		glProgramBinary(program, header.format, binary, header.size);
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	}
+	free(binary);
+
+	if (!linked)
+	{
+		cache.rejected++;
+		print("shader cache reject : %s\n", name);
+		return false;
+	}
+
+	uint64_t load_ns = profiler_now() - begin;
+	cache.hits++;
+	cache.load_ns  += load_ns;
+	cache.saved_ns += header.compile_ns > load_ns ? header.compile_ns - load_ns : 0;
+
+	print("shader cache hit    : %s (%.2f ms, %.2f ms to compile)\n", name, load_ns / 1e6, header.compile_ns / 1e6);
+	return true;
+}
+
+// after linking, the program needs GL_PROGRAM_BINARY_RETRIEVABLE_HINT set before it
+void program_cache_save(GLuint program, uint64_t key, uint64_t compile_ns)
+{
+	Program_Cache& cache = global_program_cache;
+	cache.compile_ns += compile_ns;
+	if (cache.disabled) return;
+
+	GLint linked = GL_FALSE, size = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (!linked || size <= 0) return;
+
+	Program_Cache_Header header = {};
+	header.magic      = PROGRAM_CACHE_MAGIC;
+	header.size       = size;
+	header.compile_ns = compile_ns;
+
+	byte* binary = Alloc(byte, size);
+	glGetProgramBinary(program, size, NULL, &header.format, binary);
+
+	char path[64] = {};
+	program_cache_path(path, sizeof(path), key);
+
+	FILE* file = fopen(path, "wb");
+	if (file)
+	{
+		fwrite(&header, sizeof(header), 1, file);
+		fwrite(binary, 1, size, file);
+		fclose(file);
+	}
+	else out("ERROR : can't write '" << path << "'");
+
+	free(binary);
+}
+
+void program_cache_print()
+{
+	Program_Cache& cache = global_program_cache;
+	if (cache.disabled) { print("shader cache : the driver has no program binary formats\n"); return; }
+
+	print("shader cache : %u hits, %u misses, %u rejected | %.1f ms loading, %.1f ms compiling, %.1f ms saved\n",
+		cache.hits, cache.misses, cache.rejected, cache.load_ns / 1e6, cache.compile_ns / 1e6, cache.saved_ns / 1e6);
+}
@@ -0,0 +1,426 @@
+// the passes of a frame, declared once with what each of them reads & writes. compile() puts every pass right
+// before the first one that needs it (as far as what it needs allows), culls passes nothing on screen depends on,
+// leaves out attachments nobody reads & lets render targets whose lifetimes don't overlap share one texture.
+// every frame the passes run in that order, the graph binds their framebuffers, clears & inserts barriers :
+//
+//	for (uint i = 0; i < graph.num_scheduled; i++)
+//	{
+//		uint pass = render_graph_begin_pass(graph, i);
+//		if (pass == PASS_SKY) { ... }
+//		render_graph_end_pass();
+//	}
+//
+// writes land in the order the passes are declared : a pass reads what the passes declared before it wrote.
+// the first pass to write a texture clears it, later ones draw over it
+
+#define RENDER_GRAPH_MAX_PASSES    16
+#define RENDER_GRAPH_MAX_RESOURCES 32
+#define RENDER_GRAPH_MAX_ACCESSES  8 // reads or writes of one pass
+
+enum Graph_Resource_Kind
+{
+	GRAPH_TEXTURE,     // a render target the graph owns, allocated by compile()
+	GRAPH_FRAMEBUFFER, // imported, what the frame ends up in (the window). passes writing it are never culled
+	GRAPH_BUFFER,      // imported, written before the passes run
+};
+
+struct Graph_Resource
+{
+	const char* name;
+	Graph_Resource_Kind kind;
+	GLenum format;
+	uint width, height;
+	bool shader_written; // buffers written by compute shaders, the readers need a barrier first
+
+	GLuint id; // texture (after compile()), framebuffer or buffer
+
+	// from compile()
+	int  first_use, last_use; // indices into the schedule
+	bool read;
+	int  texture; // index into Render_Graph::textures, -1 when it isn't allocated
+};
+
+struct Graph_Read
+{
+	uint resource;
+	GLbitfield barrier; // how a shader written buffer is read (GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT, ...)
+};
+
+struct Graph_Pass
+{
+	const char* name;
+	uint id; // what render_graph_begin_pass() returns, the caller's name for the pass
+
+	Graph_Read reads[RENDER_GRAPH_MAX_ACCESSES];
+	uint num_reads;
+	uint writes[RENDER_GRAPH_MAX_ACCESSES];
+	uint num_writes;
+
+	// from compile()
+	bool scheduled;
+	GLuint framebuffer;
+	uint width, height;
+	uint clears; // a bit per write, the ones this pass writes first
+	GLbitfield barrier;
+};
+
+struct Graph_Texture
+{
+	GLuint id;
+	GLenum format;
+	uint width, height;
+	int last_use; // of the resource that has it now
+};
+
+struct Render_Graph
+{
+	Graph_Resource resources[RENDER_GRAPH_MAX_RESOURCES];
+	uint num_resources;
+
+	Graph_Pass passes[RENDER_GRAPH_MAX_PASSES];
+	uint num_passes;
+
+	uint schedule[RENDER_GRAPH_MAX_PASSES]; // passes in the order they run
+	uint num_scheduled;
+
+	Graph_Texture textures[RENDER_GRAPH_MAX_RESOURCES]; // what the GRAPH_TEXTURE resources share
+	uint num_textures;
+
+	uint current; // the pass between render_graph_begin_pass() & render_graph_end_pass()
+};
+
+bool is_depth_format(GLenum format)
+{
+	return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32 || format == GL_DEPTH_COMPONENT32F;
+}
+
+uint render_graph_resource(Render_Graph& graph, const char* name, Graph_Resource_Kind kind)
+{
+	assert(graph.num_resources < RENDER_GRAPH_MAX_RESOURCES);
+
+	uint index = graph.num_resources++;
+	Graph_Resource& resource = graph.resources[index];
+	resource.name    = name;
+	resource.kind    = kind;
+	resource.texture = -1;
+	return index;
+}
+
+// a render target, format is sized (GL_RGBA8, GL_DEPTH_COMPONENT32, ...)
+uint render_graph_texture(Render_Graph& graph, const char* name, uint width, uint height, GLenum format)
+{
+	uint index = render_graph_resource(graph, name, GRAPH_TEXTURE);
+	graph.resources[index].width  = width;
+	graph.resources[index].height = height;
+	graph.resources[index].format = format;
+	return index;
+}
+
+// framebuffer 0 is the window
+uint render_graph_import_framebuffer(Render_Graph& graph, const char* name, GLuint framebuffer, uint width, uint height)
+{
+	uint index = render_graph_resource(graph, name, GRAPH_FRAMEBUFFER);
+	graph.resources[index].id     = framebuffer;
+	graph.resources[index].width  = width;
+	graph.resources[index].height = height;
+	return index;
+}
+
+uint render_graph_import_buffer(Render_Graph& graph, const char* name, bool shader_written)
+{
+	uint index = render_graph_resource(graph, name, GRAPH_BUFFER);
+	graph.resources[index].shader_written = shader_written;
+	return index;
+}
+
+uint render_graph_pass(Render_Graph& graph, const char* name, uint id)
+{
+	assert(graph.num_passes < RENDER_GRAPH_MAX_PASSES);
+
+	uint index = graph.num_passes++;
+	graph.passes[index].name = name;
+	graph.passes[index].id   = id;
+	return index;
+}
+
+void render_graph_read(Render_Graph& graph, uint pass, uint resource, GLbitfield barrier = 0)
+{
+	Graph_Pass& p = graph.passes[pass];
+	assert(p.num_reads < RENDER_GRAPH_MAX_ACCESSES);
+	p.reads[p.num_reads++] = { resource, barrier };
+}
+
+// textures are written as attachments, a framebuffer can't share the pass with anything else
+void render_graph_write(Render_Graph& graph, uint pass, uint resource)
+{
+	Graph_Pass& p = graph.passes[pass];
+	assert(p.num_writes < RENDER_GRAPH_MAX_ACCESSES);
+	p.writes[p.num_writes++] = resource;
+}
+
+// the last pass declared before pass that writes resource, -1 when none does
+int render_graph_producer(Render_Graph& graph, uint pass, uint resource)
+{
+	for (int i = (int)pass - 1; i >= 0; i--)
+	for (uint w = 0; w < graph.passes[i].num_writes; w++)
+		if (graph.passes[i].writes[w] == resource) return i;
+	return -1;
+}
+
+// what pass depends on goes into the schedule first, then pass
+void render_graph_visit(Render_Graph& graph, uint pass)
+{
+	Graph_Pass& p = graph.passes[pass];
+	if (p.scheduled) return;
+	p.scheduled = true;
+
+	for (uint r = 0; r < p.num_reads; r++)
+	{
+		int producer = render_graph_producer(graph, pass, p.reads[r].resource);
+		if (producer >= 0) render_graph_visit(graph, producer);
+	}
+
+	// drawing over a target needs what was drawn into it before
+	for (uint w = 0; w < p.num_writes; w++)
+	{
+		int producer = render_graph_producer(graph, pass, p.writes[w]);
+		if (producer >= 0) render_graph_visit(graph, producer);
+	}
+
+	graph.schedule[graph.num_scheduled++] = pass;
+}
+
+void compile(Render_Graph& graph)
+{
+	PROFILE_SCOPE("compile render graph");
+
+	// ordering & culling : everything the passes writing to a framebuffer depend on, nothing else
+	graph.num_scheduled = 0;
+	for (uint i = 0; i < graph.num_passes; i++)
+	{
+		Graph_Pass& pass = graph.passes[i];
+		for (uint w = 0; w < pass.num_writes; w++)
+			if (graph.resources[pass.writes[w]].kind == GRAPH_FRAMEBUFFER) render_graph_visit(graph, i);
+	}
+
+	// lifetimes, in schedule order
+	for (uint i = 0; i < graph.num_resources; i++)
+	{
+		graph.resources[i].first_use = -1;
+		graph.resources[i].last_use  = -1;
+	}
+
+	for (uint s = 0; s < graph.num_scheduled; s++)
+	{
+		Graph_Pass& pass = graph.passes[graph.schedule[s]];
+
+		for (uint r = 0; r < pass.num_reads; r++)
+		{
+			Graph_Resource& resource = graph.resources[pass.reads[r].resource];
+			if (resource.first_use < 0) resource.first_use = s;
+			resource.last_use = s;
+			resource.read     = true;
+		}
+		for (uint w = 0; w < pass.num_writes; w++)
+		{
+			Graph_Resource& resource = graph.resources[pass.writes[w]];
+			if (resource.first_use < 0)
+			{
+				resource.first_use = s;
+				pass.clears |= 1 << w;
+			}
+			resource.last_use = s;
+		}
+	}
+
+	// barriers : a shader written buffer is waited for once, before its first reader, for every way it is read
+	for (uint i = 0; i < graph.num_resources; i++)
+	{
+		Graph_Resource& resource = graph.resources[i];
+		if (!resource.shader_written || !resource.read) continue;
+
+		GLbitfield barrier = 0;
+		int first_reader = -1;
+		for (uint s = 0; s < graph.num_scheduled; s++)
+		{
+			Graph_Pass& pass = graph.passes[graph.schedule[s]];
+			for (uint r = 0; r < pass.num_reads; r++)
+			{
+				if (pass.reads[r].resource != i) continue;
+				barrier |= pass.reads[r].barrier;
+				if (first_reader < 0) first_reader = s;
+			}
+		}
+		graph.passes[graph.schedule[first_reader]].barrier |= barrier;
+	}
+
+	// aliasing : every texture that is read goes into the first allocated one of the same size & format
+	// that is free by the time it is first written, in the order the textures are first used
+	uint texture_bytes = 0, resource_bytes = 0;
+	for (uint i = 0; i < graph.num_resources; i++)
+		if (graph.resources[i].kind == GRAPH_TEXTURE) resource_bytes += graph.resources[i].width * graph.resources[i].height * 4;
+
+	for (uint s = 0; s < graph.num_scheduled; s++)
+	for (uint i = 0; i < graph.num_resources; i++)
+	{
+		Graph_Resource& resource = graph.resources[i];
+		if (resource.kind != GRAPH_TEXTURE || !resource.read || resource.first_use != (int)s) continue;
+
+		uint bytes = resource.width * resource.height * 4; // every format used is 32 bits
+
+		for (uint t = 0; t < graph.num_textures && resource.texture < 0; t++)
+		{
+			Graph_Texture& texture = graph.textures[t];
+			if (texture.format == resource.format && texture.width == resource.width && texture.height == resource.height
+				&& texture.last_use < resource.first_use) resource.texture = t;
+		}
+
+		if (resource.texture < 0)
+		{
+			resource.texture = graph.num_textures++;
+			Graph_Texture& texture = graph.textures[resource.texture];
+			texture.format = resource.format;
+			texture.width  = resource.width;
+			texture.height = resource.height;
+
+			glGenTextures(1, &texture.id);
+			glBindTexture(GL_TEXTURE_2D, texture.id);
+			glTexStorage2D(GL_TEXTURE_2D, 1, resource.format, resource.width, resource.height);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+
+			texture_bytes += bytes;
+		}
+
+		graph.textures[resource.texture].last_use = resource.last_use;
+		resource.id = graph.textures[resource.texture].id;
+	}
+
+	// a framebuffer per pass with the attachments that are read later
+	for (uint s = 0; s < graph.num_scheduled; s++)
+	{
+		Graph_Pass& pass = graph.passes[graph.schedule[s]];
+
+		GLenum draw_buffers[RENDER_GRAPH_MAX_ACCESSES] = {};
+		uint num_color = 0;
+
+		for (uint w = 0; w < pass.num_writes; w++)
+		{
+			Graph_Resource& resource = graph.resources[pass.writes[w]];
+			if (resource.kind == GRAPH_FRAMEBUFFER)
+			{
+				pass.framebuffer = resource.id;
+				pass.width       = resource.width;
+				pass.height      = resource.height;
+				break;
+			}
+			if (resource.kind != GRAPH_TEXTURE || resource.texture < 0) continue;
+
+			if (!pass.framebuffer)
+			{
+				glGenFramebuffers(1, &pass.framebuffer);
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, pass.framebuffer);
+			}
+
+			if (is_depth_format(resource.format))
+				glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, resource.id, 0);
+			else
+			{
+				draw_buffers[num_color] = GL_COLOR_ATTACHMENT0 + num_color;
+				glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, draw_buffers[num_color++], GL_TEXTURE_2D, resource.id, 0);
+			}
+
+			pass.width  = resource.width;
+			pass.height = resource.height;
+		}
+
+		if (pass.framebuffer && graph.resources[pass.writes[0]].kind != GRAPH_FRAMEBUFFER)
+		{
+			if (num_color) glDrawBuffers(num_color, draw_buffers);
+			else           glDrawBuffer(GL_NONE);
+
+			if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+				out("ERROR : the framebuffer of pass '" << pass.name << "' is incomplete");
+		}
+	}
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+	print("render graph : %u of %u passes,", graph.num_scheduled, graph.num_passes);
+	for (uint s = 0; s < graph.num_scheduled; s++) print(" %s", graph.passes[graph.schedule[s]].name);
+	print(" | %.1f MB of render targets in %u textures (%.1f MB as a texture each)\n", texture_bytes / 1e6, graph.num_textures, resource_bytes / 1e6);
+
+	for (uint i = 0; i < graph.num_resources; i++)
+	{
+		Graph_Resource& resource = graph.resources[i];
+		if (resource.kind == GRAPH_TEXTURE && !resource.read) print("render graph : nothing reads '%s', it isn't allocated\n", resource.name);
+	}
+	for (uint i = 0; i < graph.num_passes; i++)
+		if (!graph.passes[i].scheduled) print("render graph : nothing depends on pass '%s', it is culled\n", graph.passes[i].name);
+}
+
+// to bind a texture for reading, valid after compile()
+GLuint render_graph_texture_id(Render_Graph& graph, uint resource)
+{
+	return graph.resources[resource].id;
+}
+
+// binds the framebuffer of the index'th pass to run, sets the viewport to it, clears what it writes first &
+// waits for what it reads. returns its id
+uint render_graph_begin_pass(Render_Graph& graph, uint index)
+{
+	graph.current = graph.schedule[index];
+	Graph_Pass& pass = graph.passes[graph.current];
+
+	if (pass.barrier) glMemoryBarrier(pass.barrier);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, pass.framebuffer);
+	if (pass.width) glViewport(0, 0, pass.width, pass.height);
+
+	uint color = 0;
+	for (uint w = 0; w < pass.num_writes; w++)
+	{
+		Graph_Resource& resource = graph.resources[pass.writes[w]];
+		bool clear = pass.clears & (1 << w);
+
+		if (resource.kind == GRAPH_FRAMEBUFFER)
+		{
+			if (clear) glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			break;
+		}
+		if (resource.kind != GRAPH_TEXTURE || resource.texture < 0) continue;
+
+		if (is_depth_format(resource.format))
+		{
+			float depth = 1;
+			if (clear) glClearBufferfv(GL_DEPTH, 0, &depth);
+		}
+		else
+		{
+			vec4 black = vec4(0, 0, 0, 1);
+			if (clear) glClearBufferfv(GL_COLOR, color, (float*)&black);
+			color++;
+		}
+	}
+
+	return pass.id;
+}
+void render_graph_end_pass()
+{
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+void free(Render_Graph& graph)
+{
+	for (uint i = 0; i < graph.num_passes; i++)
+	{
+		Graph_Pass& pass = graph.passes[i];
+		bool owned = pass.num_writes && graph.resources[pass.writes[0]].kind != GRAPH_FRAMEBUFFER;
+		if (owned && pass.framebuffer) glDeleteFramebuffers(1, &pass.framebuffer);
+	}
+	for (uint i = 0; i < graph.num_textures; i++) glDeleteTextures(1, &graph.textures[i].id);
+
+	graph = {};
+}
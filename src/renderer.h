@@ -1,27 +1,52 @@
 #include "window.h"
+#include "files.h"
+#include "program_cache.h"
 
 #define DRAW_DISTANCE 1024.0f
 
 // -------------------- Shaders -------------------- //
 
+// a shader file straight from its mapping. there is no 0 at the end, so the text always goes with its length
+struct Shader_Source
+{
+	const char* text;
+	GLint length;
+};
+
+Shader_Source read_shader_source(const char* path)
+{
+	File_View file = read_file(path);
+	if (!file.data) out("ERROR : '" << path << "' NOT FOUND!");
+
+	return { file.data ? (const char*)file.data : "", (GLint)file.size };
+}
+
 struct Shader { GLuint id; };
 
 void load(Shader* shader, const char* vert_path, const char* frag_path)
 {
-	char* vert_source = (char*)read_text_file_into_memory(vert_path);
-	char* frag_source = (char*)read_text_file_into_memory(frag_path);
+	PROFILE_SCOPE("load shader");
+
+	Shader_Source vert_source = read_shader_source(vert_path);
+	Shader_Source frag_source = read_shader_source(frag_path);
+
+	const char* sources[] = { vert_source.text  , frag_source.text   };
+	GLint       lengths[] = { vert_source.length, frag_source.length };
+	uint64_t cache_key = program_cache_key(sources, lengths, 2);
+
+	shader->id = glCreateProgram();
+	if (program_cache_load(shader->id, cache_key, vert_path)) return;
+
+	uint64_t compile_begin = profiler_now();
 
 	GLuint vert_shader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vert_shader, 1, &vert_source, NULL);
+	glShaderSource(vert_shader, 1, &vert_source.text, &vert_source.length);
 	glCompileShader(vert_shader);
 
 	GLuint frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(frag_shader, 1, &frag_source, NULL);
+	glShaderSource(frag_shader, 1, &frag_source.text, &frag_source.length);
 	glCompileShader(frag_shader);
 
-	free(vert_source);
-	free(frag_source);
-
 	{
 		GLint log_size = 0;
 		glGetShaderiv(vert_shader, GL_INFO_LOG_LENGTH, &log_size);
@@ -44,9 +69,9 @@ void load(Shader* shader, const char* vert_path, const char* frag_path)
 		}
 	}
 
-	shader->id = glCreateProgram();
 	glAttachShader(shader->id, vert_shader);
 	glAttachShader(shader->id, frag_shader);
+	glProgramParameteri(shader->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram (shader->id);
 
 	GLsizei length = 0;
@@ -56,6 +81,8 @@ void load(Shader* shader, const char* vert_path, const char* frag_path)
 
 	glDeleteShader(vert_shader);
 	glDeleteShader(frag_shader);
+
+	program_cache_save(shader->id, cache_key, profiler_now() - compile_begin);
 }
 void bind(Shader shader)
 {
@@ -68,16 +95,40 @@ void free(Shader shader)
 
 struct Compute_Shader { GLuint id; };
 
-void load(Compute_Shader* shader, const char* path)
+// glShaderSource() with extra #defines inserted right after the #version line
+void shader_source(GLuint shader, Shader_Source source, const char* defines = NULL)
+{
+	const char* end  = source.text + source.length;
+	const char* body = source.text;
+	while (body < end && *body != '\n') body++;
+	if (body < end) body++;
+
+	const char* parts[3] = { source.text, defines ? defines : "", body };
+	GLint lengths[3] = { GLint(body - source.text), -1, GLint(end - body) };
+
+	glShaderSource(shader, 3, parts, lengths);
+}
+
+// defines = "#define A\n#define B 4\n" for compiling variants of the same file
+void load(Compute_Shader* shader, const char* path, const char* defines = NULL)
 {
-	char* source = (char*)read_text_file_into_memory(path);
+	PROFILE_SCOPE("load compute shader");
+
+	Shader_Source source = read_shader_source(path);
+
+	const char* sources[] = { source.text  , defines };
+	GLint       lengths[] = { source.length, -1      };
+	uint64_t cache_key = program_cache_key(sources, lengths, 2);
+
+	shader->id = glCreateProgram();
+	if (program_cache_load(shader->id, cache_key, path)) return;
+
+	uint64_t compile_begin = profiler_now();
 
 	GLuint comp_shader = glCreateShader(GL_COMPUTE_SHADER);
-	glShaderSource(comp_shader, 1, &source, NULL);
+	shader_source(comp_shader, source, defines);
 	glCompileShader(comp_shader);
 
-	free(source);
-
 	{
 		GLint log_size = 0;
 		glGetShaderiv(comp_shader, GL_INFO_LOG_LENGTH, &log_size);
@@ -91,8 +142,8 @@ void load(Compute_Shader* shader, const char* path)
 		}
 	}
 
-	shader->id = glCreateProgram();
 	glAttachShader(shader->id, comp_shader);
+	glProgramParameteri(shader->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(shader->id);
 
 	GLsizei length = 0;
@@ -101,6 +152,8 @@ void load(Compute_Shader* shader, const char* path)
 	if (length) out(error);
 
 	glDeleteShader(comp_shader);
+
+	program_cache_save(shader->id, cache_key, profiler_now() - compile_begin);
 }
 void bind(Compute_Shader shader)
 {
@@ -111,26 +164,33 @@ struct Shader_Compute_Render { GLuint id; };
 
 void load(Shader_Compute_Render* shader, const char* vert, const char* frag, const char* comp)
 {
-	char* vert_source = (char*)read_text_file_into_memory(vert);
-	char* frag_source = (char*)read_text_file_into_memory(frag);
-	char* comp_source = (char*)read_text_file_into_memory(comp);
+	PROFILE_SCOPE("load shader");
+
+	Shader_Source vert_source = read_shader_source(vert);
+	Shader_Source frag_source = read_shader_source(frag);
+	Shader_Source comp_source = read_shader_source(comp);
+
+	const char* sources[] = { vert_source.text  , frag_source.text  , comp_source.text   };
+	GLint       lengths[] = { vert_source.length, frag_source.length, comp_source.length };
+	uint64_t cache_key = program_cache_key(sources, lengths, 3);
+
+	shader->id = glCreateProgram();
+	if (program_cache_load(shader->id, cache_key, vert)) return;
+
+	uint64_t compile_begin = profiler_now();
 
 	GLuint vert_shader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vert_shader, 1, &vert_source, NULL);
+	glShaderSource(vert_shader, 1, &vert_source.text, &vert_source.length);
 	glCompileShader(vert_shader);
 
 	GLuint frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(frag_shader, 1, &frag_source, NULL);
+	glShaderSource(frag_shader, 1, &frag_source.text, &frag_source.length);
 	glCompileShader(frag_shader);
 
 	GLuint comp_shader = glCreateShader(GL_COMPUTE_SHADER);
-	glShaderSource(comp_shader, 1, &comp_source, NULL);
+	glShaderSource(comp_shader, 1, &comp_source.text, &comp_source.length);
 	glCompileShader(comp_shader);
 
-	free(vert_source);
-	free(frag_source);
-	free(comp_source);
-
 	{
 		GLint log_size = 0;
 		glGetShaderiv(vert_shader, GL_INFO_LOG_LENGTH, &log_size);
@@ -163,10 +223,10 @@ void load(Shader_Compute_Render* shader, const char* vert, const char* frag, con
 		}
 	}
 
-	shader->id = glCreateProgram();
 	glAttachShader(shader->id, vert_shader);
 	glAttachShader(shader->id, comp_shader);
 	glAttachShader(shader->id, frag_shader);
+	glProgramParameteri(shader->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(shader->id);
 
 	GLsizei length = 0;
@@ -177,6 +237,8 @@ void load(Shader_Compute_Render* shader, const char* vert, const char* frag, con
 	glDeleteShader(vert_shader);
 	glDeleteShader(frag_shader);
 	glDeleteShader(comp_shader);
+
+	program_cache_save(shader->id, cache_key, profiler_now() - compile_begin);
 }
 void bind(Shader_Compute_Render shader)
 {
@@ -196,6 +258,10 @@ void set_vec2 (Shader shader, const char* name, vec2 value)
 {
 	glUniform2f(glGetUniformLocation(shader.id, name), value.x, value.y);
 }
+void set_ivec2(Shader shader, const char* name, ivec2 value)
+{
+	glUniform2i(glGetUniformLocation(shader.id, name), value.x, value.y);
+}
 void set_vec3 (Shader shader, const char* name, vec3 value )
 {
 	glUniform3f(glGetUniformLocation(shader.id, name), value.x, value.y, value.z);
@@ -213,6 +279,32 @@ void set_mat4 (Shader shader, const char* name, mat4 value )
 	glUniformMatrix4fv(glGetUniformLocation(shader.id, name), 1, GL_FALSE, (float*)&value);
 }
 
+// by layout(location = n) instead of by name, for uniforms set every frame
+void set_int  (GLint location, int value  )
+{
+	glUniform1i(location, value);
+}
+void set_float(GLint location, float value)
+{
+	glUniform1f(location, value);
+}
+void set_vec2 (GLint location, vec2 value )
+{
+	glUniform2f(location, value.x, value.y);
+}
+void set_ivec2(GLint location, ivec2 value)
+{
+	glUniform2i(location, value.x, value.y);
+}
+void set_vec4 (GLint location, vec4 value )
+{
+	glUniform4f(location, value.x, value.y, value.z, value.w);
+}
+void set_mat3 (GLint location, mat3 value )
+{
+	glUniformMatrix3fv(location, 1, GL_FALSE, (float*)&value);
+}
+
 void mesh_add_attrib_float(GLuint attrib_id, uint stride, uint offset)
 {
 	glVertexAttribPointer(attrib_id, 1, GL_FLOAT, GL_FALSE, stride, (void*)offset);
@@ -254,18 +346,20 @@ void mesh_add_attrib_mat3 (GLuint attrib_id, uint stride, uint offset)
 
 GLuint load_texture(const char* path)
 {
+	PROFILE_SCOPE("load_texture");
+
 	GLuint id = {};
 	int width, height, num_channels;
 	byte* image;
 
 	stbi_set_flip_vertically_on_load(true);
 
-	image = stbi_load(path, &width, &height, &num_channels, 0);
+	image = load_image(path, &width, &height, &num_channels, 0);
 	if (image == NULL) out("ERROR : '" << path << "' NOT FOUND!");
 
 	glGenTextures(1, &id);
 	glBindTexture(GL_TEXTURE_2D, id);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -278,18 +372,20 @@ GLuint load_texture(const char* path)
 }
 GLuint load_texture_png(const char* path)
 {
+	PROFILE_SCOPE("load_texture_png");
+
 	GLuint id = {};
 	int width, height, num_channels;
 	byte* image;
 
 	stbi_set_flip_vertically_on_load(false);
 
-	image = stbi_load(path, &width, &height, &num_channels, 0);
+	image = load_image(path, &width, &height, &num_channels, 0);
 	if (image == NULL) out("ERROR : '" << path << "' NOT FOUND!");
 
 	glGenTextures(1, &id);
 	glBindTexture(GL_TEXTURE_2D, id);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -377,6 +473,50 @@ void camera_update_pos(Camera* camera, int direction, float distance)
 	if (direction == DIR_BACKWARD) camera->position -= camera->front * distance;
 }
 
+// scripted flights for benchmarks, the same t always gives the same view
+enum Camera_Path
+{
+	CAMERA_PATH_NONE, // keys & mouse
+	CAMERA_PATH_STILL,
+	CAMERA_PATH_ORBIT,
+	CAMERA_PATH_FLYOVER,
+};
+
+void camera_look_at(Camera* camera, vec3 target)
+{
+	vec3 dir = normalize(target - camera->position);
+	camera->yaw   = atan2(dir.z, dir.x);
+	camera->pitch = asin(dir.y);
+}
+
+// t goes from 0 to 1 over the run, the meshes span [0, 1] on x & z.
+// only sets the position & angles, camera_update_dir() turns them into the vectors
+void camera_follow_path(Camera* camera, Camera_Path path, float t)
+{
+	vec3 center = { .5f, -.25f, .5f };
+
+	if (path == CAMERA_PATH_STILL) // where the app starts
+	{
+		camera->position = { 0, .25f, 0 };
+		camera->yaw   = 0;
+		camera->pitch = 0;
+	}
+
+	if (path == CAMERA_PATH_ORBIT) // once around the grid, looking at its middle
+	{
+		float angle = TWOPI * t;
+		camera->position = center + vec3(cos(angle) * .9f, .5f, sin(angle) * .9f);
+		camera_look_at(camera, center);
+	}
+
+	if (path == CAMERA_PATH_FLYOVER) // low over the water from one edge to the other
+	{
+		camera->position = { lerp(-.2f, 1.2f, t), .1f, .5f + .2f * sin(TWOPI * t) };
+		camera->yaw   = 0;
+		camera->pitch = -.3f;
+	}
+}
+
 // -------------------- Other ------------------ //
 
 void setAttribPointer(GLuint vertexArrayObject, GLuint location, GLuint buffer, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLuint offset) {
@@ -400,21 +540,25 @@ void setAttribPointer(GLuint vertexArrayObject, GLuint location, GLuint buffer,
 
 GLuint import_texture(const char* path)
 {
+	PROFILE_SCOPE("import_texture");
+
 	int width, height, n;
-	byte* data = stbi_load(path, &width, &height, &n, 4);
+	byte* data = load_image(path, &width, &height, &n, 4);
 
 	GLuint id;
 	glGenTextures(1, &id);
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, id);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glGenerateMipmap(GL_TEXTURE_2D);
 
+	stbi_image_free(data);
+
 	return id;
 }
 GLuint create_subsurf_texture()
@@ -442,26 +586,28 @@ GLuint create_subsurf_texture()
 }
 GLuint createCubemap()
 {
+	PROFILE_SCOPE("createCubemap");
+
 	GLuint id = {};
 	glGenTextures(1, &id);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, id);
 
 	int w, h, c;
-	byte* PositiveX = stbi_load("content/textures/sky_posx.jpg", &w, &h, &c, 4);
-	byte* NegativeX = stbi_load("content/textures/sky_negx.jpg", &w, &h, &c, 4);
-	byte* PositiveY = stbi_load("content/textures/sky_posy.jpg", &w, &h, &c, 4);
-	byte* NegativeY = stbi_load("content/textures/sky_negy.jpg", &w, &h, &c, 4);
-	byte* PositiveZ = stbi_load("content/textures/sky_posz.jpg", &w, &h, &c, 4);
-	byte* NegativeZ = stbi_load("content/textures/sky_negz.jpg", &w, &h, &c, 4);
+	byte* PositiveX = load_image("content/textures/sky_posx.jpg", &w, &h, &c, 4);
+	byte* NegativeX = load_image("content/textures/sky_negx.jpg", &w, &h, &c, 4);
+	byte* PositiveY = load_image("content/textures/sky_posy.jpg", &w, &h, &c, 4);
+	byte* NegativeY = load_image("content/textures/sky_negy.jpg", &w, &h, &c, 4);
+	byte* PositiveZ = load_image("content/textures/sky_posz.jpg", &w, &h, &c, 4);
+	byte* NegativeZ = load_image("content/textures/sky_negz.jpg", &w, &h, &c, 4);
 
 	auto n = 2048;
 
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_RGBA, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, PositiveX);
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X, 0, GL_RGBA, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, NegativeX);
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 0, GL_RGBA, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, PositiveY);
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 0, GL_RGBA, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, NegativeY);
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, GL_RGBA, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, PositiveZ);
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, GL_RGBA, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, NegativeZ);
+	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_RGBA8, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, PositiveX);
+	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X, 0, GL_RGBA8, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, NegativeX);
+	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 0, GL_RGBA8, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, PositiveY);
+	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 0, GL_RGBA8, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, NegativeY);
+	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, GL_RGBA8, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, PositiveZ);
+	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, GL_RGBA8, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, NegativeZ);
 
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -473,6 +619,13 @@ GLuint createCubemap()
 
 	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
+	stbi_image_free(PositiveX);
+	stbi_image_free(NegativeX);
+	stbi_image_free(PositiveY);
+	stbi_image_free(NegativeY);
+	stbi_image_free(PositiveZ);
+	stbi_image_free(NegativeZ);
+
 	return id;
 }
 
@@ -519,7 +672,8 @@ enum Attrib {
 	Position       = 0,
 	Normal         = 1,
 	TexCoord       = 2,
-	VertexPosition = 3
+	VertexPosition = 3,
+	Displacement   = 4
 };
 
 struct Vertex {
@@ -554,6 +708,8 @@ float heightFunction(vec2 coordinate)
 };
 void create_mesh(uint resolution, bool water, vec4* positions, vec4* normals, vec2* tex_coords, uint* indices)
 {
+	PROFILE_SCOPE("create_mesh");
+
 	float DX = 0.1f / resolution; // offset for calculating normals
 
 	uint i = 0;
@@ -607,17 +763,30 @@ void create_mesh(uint resolution, bool water, vec4* positions, vec4* normals, ve
 
 struct Mesh
 {
-	GLuint positions[2];
+	GLuint positions; // static meshes only : vec4 per vertex
+	GLuint state[2];  // simulated meshes only : (height, velocity) per vertex, ping-ponged by the simulation
 	GLuint normals;
 	GLuint tex_coords;
+	GLuint displacement; // ocean only : horizontal (dx, dz) per vertex, the attribute reads 0 without it
 	GLuint elementArrayBuffer;
-	GLuint VAO;
+	GLuint VAO[2];    // one per state buffer
 	GLuint num_indices;
 	GLuint mesh_size;
+
+	uint   current;      // state[current] is the latest
+	GLenum state_format; // GL_RG32F or GL_RG16F, 0 for static meshes
 };
 
-void init(Mesh& mesh, uint resolution, bool water = false)
+uint state_size(GLenum state_format)
+{
+	return state_format == GL_RG16F ? 2 * sizeof(GLhalf) : 2 * sizeof(GLfloat);
+}
+
+// simulated meshes store only height & velocity, the vertex shaders rebuild x/z from gl_VertexID
+void init(Mesh& mesh, uint resolution, bool simulated = false, GLenum state_format = GL_RG32F)
 {
+	PROFILE_SCOPE("init mesh");
+
 	uint num_vertices = (resolution + 1) * (resolution + 1);
 	uint num_indices  = resolution * resolution * 6;
 
@@ -626,23 +795,39 @@ void init(Mesh& mesh, uint resolution, bool water = false)
 	vec2* tex_coords = Alloc(vec2, num_vertices);
 	uint* indices    = Alloc(uint, num_indices);
 
-	create_mesh(resolution, water, positions, normals, tex_coords, indices);
+	create_mesh(resolution, simulated, positions, normals, tex_coords, indices);
 
-	mesh.num_indices = num_indices;
-	mesh.mesh_size   = resolution;
+	mesh.num_indices  = num_indices;
+	mesh.mesh_size    = resolution;
+	mesh.current      = 0;
+	mesh.state_format = simulated ? state_format : 0;
 
-	// Position Buffers (2 of them)
-	glGenBuffers(2, mesh.positions);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.positions[0]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec4) * num_vertices, positions, GL_DYNAMIC_COPY);
+	if (simulated)
+	{
+		// the water starts flat & still, which is all zeros in either format
+		uint size = state_size(state_format) * num_vertices;
+		byte* state = Alloc(byte, size);
+
+		glGenBuffers(2, mesh.state);
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.state[0]);
+		glBufferData(GL_ARRAY_BUFFER, size, state, GL_DYNAMIC_COPY);
 
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.positions[1]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec4) * num_vertices, positions, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.state[1]);
+		glBufferData(GL_ARRAY_BUFFER, size, state, GL_DYNAMIC_COPY);
+
+		free(state);
+	}
+	else
+	{
+		glGenBuffers(1, &mesh.positions);
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.positions);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vec4) * num_vertices, positions, GL_STATIC_DRAW);
+	}
 
 	// Normal Buffer
 	glGenBuffers(1, &mesh.normals);
 	glBindBuffer(GL_ARRAY_BUFFER, mesh.normals);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec4) * num_vertices, normals, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vec4) * num_vertices, normals, simulated ? GL_DYNAMIC_COPY : GL_STATIC_DRAW);
 
 	// TexCoord Buffer
 	glGenBuffers(1, &mesh.tex_coords);
@@ -654,19 +839,30 @@ void init(Mesh& mesh, uint resolution, bool water = false)
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.elementArrayBuffer);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * mesh.num_indices, indices, GL_STATIC_DRAW);
 
-	glGenVertexArrays(1, &mesh.VAO);
+	uint num_vaos = simulated ? 2 : 1;
+	glGenVertexArrays(num_vaos, mesh.VAO);
 
-	setAttribPointer(mesh.VAO, Attrib::Position, mesh.positions[0], 3, GL_FLOAT, GL_FALSE, sizeof(vec4), 0);
-	setAttribPointer(mesh.VAO, Attrib::Normal  , mesh.normals     , 3, GL_FLOAT, GL_TRUE , sizeof(vec4), 0);
-	setAttribPointer(mesh.VAO, Attrib::TexCoord, mesh.tex_coords  , 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+	for (uint i = 0; i < num_vaos; i++)
+	{
+		if (simulated)
+		{
+			GLenum type = state_format == GL_RG16F ? GL_HALF_FLOAT : GL_FLOAT;
+			setAttribPointer(mesh.VAO[i], Attrib::Position, mesh.state[i], 2, type, GL_FALSE, state_size(state_format), 0);
+		}
+		else setAttribPointer(mesh.VAO[i], Attrib::Position, mesh.positions, 3, GL_FLOAT, GL_FALSE, sizeof(vec4), 0);
+
+		setAttribPointer(mesh.VAO[i], Attrib::Normal  , mesh.normals   , 3, GL_FLOAT, GL_TRUE , sizeof(vec4), 0);
+		setAttribPointer(mesh.VAO[i], Attrib::TexCoord, mesh.tex_coords, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+	}
+
+	free(positions);
+	free(normals);
+	free(tex_coords);
+	free(indices);
 }
 void render(Mesh& mesh)
 {
-	static bool flip = false;
-	if (flip = !flip)
-		std::swap(mesh.positions[0], mesh.positions[1]);
-
-	glBindVertexArray(mesh.VAO);
+	glBindVertexArray(mesh.VAO[mesh.state_format ? mesh.current : 0]);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.elementArrayBuffer);
 	glDrawElements(GL_TRIANGLES, mesh.num_indices, GL_UNSIGNED_INT, nullptr);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -0,0 +1,197 @@
+// gpu shallow water (content/shaders/shallowwater.comp), shallow_water_cpu.h has the cpu version of the same step.
+// runs instead of Water_Simulation over the same water mesh, on the same fixed timestep
+
+struct Shallow_Water
+{
+	Compute_Shader flux_pass;  // outflow from the surface heights
+	Compute_Shader depth_pass; // moves the water & writes the mesh state
+
+	uint dimension;
+	uint tiles_per_side;
+
+	GLuint depth; // float per cell
+	GLuint flux;  // vec4 per cell, outflow per side (-x, +x, -y, +y)
+
+	float time;        // simulated seconds
+	float accumulator; // frame time not simulated yet
+	float substep_dt;  // WATER_FIXED_TIMESTEP / substeps
+	uint  substeps;    // per fixed step, from the cfl limit
+};
+
+// largest dt where the pipes are stable for water up to max_depth deep : sqrt(g d) * dt / l <= 1 / sqrt(2) in 2d
+float shallow_water_max_time_step(uint dimension, float max_depth)
+{
+	float l = 1.f / (dimension - 1);
+	return WATER_CFL_SAFETY * l / (sqrt(SHALLOW_WATER_GRAVITY * glm::max(max_depth, SHALLOW_WATER_DRY_DEPTH)) * sqrt(2.f));
+}
+
+// the bed is ground.positions, everything under y = 0 starts out filled up to it
+void init(Shallow_Water& sw, Mesh& water, Mesh& ground)
+{
+	sw.dimension      = water.mesh_size + 1;
+	sw.tiles_per_side = (sw.dimension + WATER_SIM_TILE_SIZE - 1) / WATER_SIM_TILE_SIZE;
+
+	load(&sw.flux_pass, "content/shaders/shallowwater.comp", "#define FLUX_PASS\n");
+
+	const char* state_define = water.state_format == GL_RG16F ? "#define HALF_STATE\n" : "";
+	load(&sw.depth_pass, "content/shaders/shallowwater.comp", state_define);
+
+	uint D = sw.dimension;
+	vec4*  terrain = Alloc(vec4 , D * D);
+	float* depth   = Alloc(float, D * D);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ground.positions);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(vec4) * D * D, terrain);
+
+	float max_depth = 0;
+	for (uint i = 0; i < D * D; i++)
+	{
+		depth[i]  = glm::max(0.f, -terrain[i].y);
+		max_depth = glm::max(max_depth, depth[i]);
+	}
+
+	// twice the deepest water at the start, floods pile up a bit on top of that
+	sw.substeps   = (uint)ceil(WATER_FIXED_TIMESTEP / shallow_water_max_time_step(D, 2 * max_depth));
+	sw.substep_dt = WATER_FIXED_TIMESTEP / sw.substeps;
+
+	glGenBuffers(1, &sw.depth);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sw.depth);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * D * D, depth, GL_DYNAMIC_COPY);
+
+	vec4* flux = Alloc(vec4, D * D);
+	glGenBuffers(1, &sw.flux);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sw.flux);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(vec4) * D * D, flux, GL_DYNAMIC_COPY);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	free(terrain);
+	free(depth);
+	free(flux);
+}
+void free(Shallow_Water& sw)
+{
+	glDeleteBuffers(1, &sw.depth);
+	glDeleteBuffers(1, &sw.flux);
+	sw = {};
+}
+
+// binds the program, its uniforms & every buffer shallowwater.comp uses
+void shallow_water_bind(Shallow_Water& sw, Compute_Shader shader, Mesh& water, Mesh& ground, float dt, float time)
+{
+	glUseProgram(shader.id);
+
+	glUniform1i(0, sw.dimension);
+	glUniform1f(1, dt          );
+	glUniform1f(2, time        );
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sw.depth                 );
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, sw.flux                  );
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, water.normals            );
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, ground.positions         );
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, water.state[water.current]);
+}
+
+// one step, depth & flux are updated in place so there is nothing to flip
+void shallow_water_step(Shallow_Water& sw, Mesh& water, Mesh& ground, float dt, float time)
+{
+	shallow_water_bind(sw, sw.flux_pass, water, ground, dt, time);
+	glDispatchCompute(sw.tiles_per_side, sw.tiles_per_side, 1);
+
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	shallow_water_bind(sw, sw.depth_pass, water, ground, dt, time);
+	glDispatchCompute(sw.tiles_per_side, sw.tiles_per_side, 1);
+}
+
+// advances the water by frame_time in substep_dt steps, returns how many steps ran. same as water_simulation_update()
+uint shallow_water_update(Shallow_Water& sw, Mesh& water, Mesh& ground, float frame_time)
+{
+	sw.accumulator += frame_time;
+
+	uint num_steps = (uint)(sw.accumulator / sw.substep_dt);
+	if (num_steps > WATER_MAX_SUBSTEPS)
+	{
+		num_steps = WATER_MAX_SUBSTEPS;
+		sw.accumulator = 0;
+	}
+	else sw.accumulator -= num_steps * sw.substep_dt;
+
+	for (uint i = 0; i < num_steps; i++)
+	{
+		if (i > 0) glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		shallow_water_step(sw, water, ground, sw.substep_dt, sw.time);
+		sw.time += sw.substep_dt;
+	}
+
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	return num_steps;
+}
+
+// cpu solver over the same terrain the gpu uses
+void init(Shallow_Water_CPU& water, uint dimension, GLuint terrain_positions, Thread_Pool* pool = NULL)
+{
+	uint D = dimension;
+	vec4*  positions = Alloc(vec4 , D * D);
+	float* heights   = Alloc(float, D * D);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, terrain_positions);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(vec4) * D * D, positions);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	for (uint i = 0; i < D * D; i++) heights[i] = positions[i].y;
+	init(water, dimension, heights, pool);
+
+	free(positions);
+	free(heights);
+}
+
+// copies the gpu water into the cpu solver, runs one step on both & compares depth & mesh state
+bool shallow_water_compare(Shallow_Water& sw, Shallow_Water_CPU& cpu, Mesh& water, Mesh& ground, float dt, float time, float tolerance = 1e-5f)
+{
+	uint D = sw.dimension;
+
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sw.depth);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(float) * D * D, cpu.depth);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sw.flux);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(vec4) * D * D, cpu.flux);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	shallow_water_step(sw, water, ground, dt, time);
+	shallow_water_step(cpu, dt, time);
+	sw.time += dt; // the gpu water really moved on a step
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	float* gpu_depth = Alloc(float, D * D);
+	vec2*  gpu_state = Alloc(vec2 , D * D);
+	vec2*  cpu_state = Alloc(vec2 , D * D);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sw.depth);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(float) * D * D, gpu_depth);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	read_state_buffer(water.state[water.current], water.state_format, gpu_state, D * D);
+	shallow_water_read_state(cpu, cpu_state);
+
+	float depth_error = 0, state_error = 0;
+	for (uint i = 0; i < D * D; i++)
+	{
+		vec2 ds = glm::abs(gpu_state[i] - cpu_state[i]);
+		depth_error = glm::max(depth_error, glm::abs(gpu_depth[i] - cpu.depth[i]));
+		state_error = glm::max(state_error, glm::max(ds.x, ds.y));
+	}
+
+	// the cpu keeps full floats, so half state only matches to ~3 digits
+	float state_tolerance = water.state_format == GL_RG16F ? glm::max(tolerance, 1e-3f) : tolerance;
+
+	bool match = depth_error <= tolerance && state_error <= state_tolerance;
+	print("shallow water gpu vs cpu : depth %g, state %g -> %s\n", depth_error, state_error, match ? "match" : "MISMATCH");
+
+	free(gpu_depth);
+	free(gpu_state);
+	free(cpu_state);
+
+	return match;
+}
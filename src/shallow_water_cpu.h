@@ -0,0 +1,167 @@
+// CPU version of content/shaders/shallowwater.comp
+// used as ground truth for the gpu results & where there is no gpu
+
+// these have to match shallowwater.comp
+#define SHALLOW_WATER_GRAVITY     0.0981f // the mesh is 1 unit across, ~100m
+#define SHALLOW_WATER_DAMPING     0.999f  // per step on the pipe flux
+#define SHALLOW_WATER_SOURCE_RATE 0.02f   // depth per second added at the ripple position while it is on
+#define SHALLOW_WATER_DRY_DEPTH   1e-4f   // below this a cell counts as dry
+#define SHALLOW_WATER_DRY_OFFSET  1e-3f   // dry cells are drawn this far under the terrain
+
+// virtual pipes between neighbouring cells (mei, decaudin & hu 2007) : every cell has an outflow
+// through each of its 4 sides, driven by the difference in surface height (terrain + depth).
+// water carries mass, so it runs up onto dry terrain & drains off it. depth never goes negative
+struct Shallow_Water_CPU
+{
+	uint dimension; // cells per side (mesh_size + 1)
+
+	float* depth;
+	vec4*  flux;    // outflow per side (-x, +x, -y, +y)
+	float* terrain; // bed height per cell
+
+	Thread_Pool* pool;
+};
+
+void init(Shallow_Water_CPU& water, uint dimension, const float* terrain_heights, Thread_Pool* pool = NULL)
+{
+	uint num_cells = dimension * dimension;
+
+	water.dimension = dimension;
+	water.pool      = pool;
+	water.depth     = Alloc(float, num_cells);
+	water.flux      = Alloc(vec4 , num_cells);
+	water.terrain   = Alloc(float, num_cells);
+
+	// starts as the flat sheet at y = 0 the wave solver uses
+	for (uint i = 0; i < num_cells; i++)
+	{
+		water.terrain[i] = terrain_heights[i];
+		water.depth  [i] = glm::max(0.f, -terrain_heights[i]);
+	}
+}
+void free(Shallow_Water_CPU& water)
+{
+	free(water.depth);
+	free(water.flux);
+	free(water.terrain);
+	water = {};
+}
+
+struct Shallow_Water_CPU_Step
+{
+	Shallow_Water_CPU* water;
+	float delta_time;
+	float time;
+};
+
+float shallow_water_surface(Shallow_Water_CPU& water, int x, int y)
+{
+	uint i = (y * water.dimension) + x;
+	return water.terrain[i] + water.depth[i];
+}
+
+// row y : new outflow from the surface heights, scaled down so a cell never loses more water than it has
+void shallow_water_flux_job(uint y, uint thread_index, void* params)
+{
+	Shallow_Water_CPU_Step* step = (Shallow_Water_CPU_Step*)params;
+	Shallow_Water_CPU& water = *step->water;
+
+	int   D  = water.dimension;
+	float dt = step->delta_time;
+	float l  = 1.f / (D - 1);
+
+	int row = y; // signed like x & D
+
+	for (int x = 0; x < D; x++)
+	{
+		uint i = (row * D) + x;
+		float h = shallow_water_surface(water, x, row);
+
+		// closed borders : nothing flows out of the grid
+		vec4 dh = vec4(0);
+		if (x   > 0    ) dh.x = h - shallow_water_surface(water, x - 1, row);
+		if (x   < D - 1) dh.y = h - shallow_water_surface(water, x + 1, row);
+		if (row > 0    ) dh.z = h - shallow_water_surface(water, x, row - 1);
+		if (row < D - 1) dh.w = h - shallow_water_surface(water, x, row + 1);
+
+		// pipe cross section l^2 & length l : f += dt * g * l * dh
+		vec4 f = glm::max(vec4(0), water.flux[i] * SHALLOW_WATER_DAMPING + dh * (dt * SHALLOW_WATER_GRAVITY * l));
+		if (x   == 0    ) f.x = 0;
+		if (x   == D - 1) f.y = 0;
+		if (row == 0    ) f.z = 0;
+		if (row == D - 1) f.w = 0;
+
+		float total = f.x + f.y + f.z + f.w;
+		if (total > 0) f *= glm::min(1.f, (water.depth[i] * l * l) / (total * dt));
+
+		water.flux[i] = f;
+	}
+}
+
+// row y : depth from what flowed in & out, plus the source
+void shallow_water_depth_job(uint y, uint thread_index, void* params)
+{
+	Shallow_Water_CPU_Step* step = (Shallow_Water_CPU_Step*)params;
+	Shallow_Water_CPU& water = *step->water;
+
+	int   D  = water.dimension;
+	float dt = step->delta_time;
+	float l  = 1.f / (D - 1);
+
+	int row = y; // signed like x & D
+
+	bool source_on = int(step->time) % WATER_RIPPLE_PERIOD == 0;
+	vec2 source_position = vec2(D * 0.3f, D * 0.6f);
+
+	for (int x = 0; x < D; x++)
+	{
+		uint i = (row * D) + x;
+		vec4 f = water.flux[i];
+
+		float inflow = 0;
+		if (x   > 0    ) inflow += water.flux[i - 1].y;
+		if (x   < D - 1) inflow += water.flux[i + 1].x;
+		if (row > 0    ) inflow += water.flux[i - D].w;
+		if (row < D - 1) inflow += water.flux[i + D].z;
+
+		float outflow = f.x + f.y + f.z + f.w;
+		float depth = glm::max(0.f, water.depth[i] + dt * (inflow - outflow) / (l * l));
+
+		if (source_on) depth += dt * SHALLOW_WATER_SOURCE_RATE * exp(-.5f * glm::length(vec2(x, row) - source_position));
+
+		water.depth[i] = depth;
+	}
+}
+
+void shallow_water_step(Shallow_Water_CPU& water, float dt, float time)
+{
+	Shallow_Water_CPU_Step step = { &water, dt, time };
+
+	// every flux has to be done before any depth changes
+	parallel_for(water.pool, water.dimension, shallow_water_flux_job , &step, true);
+	parallel_for(water.pool, water.dimension, shallow_water_depth_job, &step, true);
+}
+
+// the same (surface height, speed) the gpu writes into the water mesh
+void shallow_water_read_state(Shallow_Water_CPU& water, vec2* state)
+{
+	int D = water.dimension;
+	float l = 1.f / (D - 1);
+
+	for (int y = 0; y < D; y++) {
+	for (int x = 0; x < D; x++)
+	{
+		uint i = (y * D) + x;
+		float depth = water.depth[i];
+		vec4  f     = water.flux [i];
+
+		// volume per second through the cell, averaged over its two sides
+		float in_x = x > 0 ? water.flux[i - 1].y : 0, back_x = x < D - 1 ? water.flux[i + 1].x : 0;
+		float in_y = y > 0 ? water.flux[i - D].w : 0, back_y = y < D - 1 ? water.flux[i + D].z : 0;
+		vec2 flow = vec2(in_x - f.x + f.y - back_x, in_y - f.z + f.w - back_y) * .5f;
+
+		bool wet = depth > SHALLOW_WATER_DRY_DEPTH;
+		float speed = wet ? glm::length(flow) / (l * depth) : 0;
+		state[i] = vec2(wet ? water.terrain[i] + depth : water.terrain[i] - SHALLOW_WATER_DRY_OFFSET, speed);
+	} }
+}
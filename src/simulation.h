@@ -0,0 +1,639 @@
+// gpu water simulation, simulation_cpu.h has the cpu version of the same step
+
+// the tile scheduler only steps tiles that are wet & moving (or next to one that is)
+#define WATER_TILE_WAKE_STEPS       8     // steps a tile keeps running after it settles
+#define WATER_ACTIVITY_THRESHOLD    1e-6f // |velocity| or |height change| that counts as moving
+
+// the simulation runs at a fixed rate no matter how fast we render
+#define WATER_FIXED_TIMESTEP        (1.f / 60)
+#define WATER_CFL_SAFETY            0.5f  // fraction of the largest stable step that is actually used
+#define WATER_MAX_SUBSTEPS          32    // per rendered frame, anything past that is dropped
+
+// steps per dispatch of watertemporal.comp, the tile + halo has to fit in shared memory
+#define WATER_MAX_TEMPORAL_STEPS    8
+
+// implicit integrators step this many times further than the explicit cfl limit, even past WATER_FIXED_TIMESTEP
+#define WATER_IMPLICIT_STEP_MULTIPLE 20
+
+struct Dispatch_Indirect_Command
+{
+	GLuint num_groups_x;
+	GLuint num_groups_y;
+	GLuint num_groups_z;
+};
+
+// implicit steps : multigrid levels of the finest grid, see simulation_implicit_cpu.h
+struct Water_Multigrid
+{
+	// one variant of watermultigrid.comp per pass
+	Compute_Shader prepare;
+	Compute_Shader smooth;
+	Compute_Shader find_residual;
+	Compute_Shader restriction;
+	Compute_Shader prolongation;
+	Compute_Shader finish;
+
+	uint   num_levels;
+	uint   dimension[WATER_MULTIGRID_MAX_LEVELS];
+	GLuint x        [WATER_MULTIGRID_MAX_LEVELS];
+	GLuint rhs      [WATER_MULTIGRID_MAX_LEVELS];
+	GLuint residuals[WATER_MULTIGRID_MAX_LEVELS];
+	GLuint active   [WATER_MULTIGRID_MAX_LEVELS]; // uint per cell
+	GLuint residual_norm;
+
+	// the last solve
+	uint  cycles;
+	float residual; // max |residual| / (1 + 4a)
+};
+
+struct Water_Simulation
+{
+	Compute_Shader step;       // every tile
+	Compute_Shader step_tiles; // only the tiles in tile_list
+	Compute_Shader schedule;   // builds tile_list
+	Compute_Shader step_temporal; // temporal_steps steps per dispatch, every tile
+
+	uint temporal_steps; // 1 = one step per dispatch
+
+	Water_Integrator integrator;
+	Water_Multigrid  multigrid; // only with an implicit integrator
+
+	// absorbing layer along the edge, 0 = the edge reflects
+	uint  sponge_width;    // in cells
+	float sponge_strength; // velocity damping rate (1 / s) at the edge
+
+	uint dimension;
+	uint tiles_per_side;
+	uint num_tiles;
+
+	float time;        // simulated seconds
+	float accumulator; // frame time not simulated yet
+	float substep_dt;  // WATER_FIXED_TIMESTEP / substeps, or the implicit step
+	uint  substeps;    // per fixed step, from the cfl limit. 1 for implicit steps, they can span several
+
+	bool   use_tile_scheduler;
+	GLuint tile_wet;      // uint per tile : 1 if any cell in it is under water level
+	GLuint tile_activity; // uint per tile : steps left before the tile goes to sleep
+	GLuint tile_list;     // tiles to step this frame
+	GLuint dispatch_args; // Dispatch_Indirect_Command for step_tiles
+};
+
+// largest dt where the explicit step is stable : c * dt / h <= 1 / sqrt(2) in 2d
+float water_max_time_step(uint dimension)
+{
+	float h = 2.f / dimension;
+	return WATER_CFL_SAFETY * h / (WATER_WAVE_SPEED * sqrt(2.f));
+}
+
+// the multigrid passes & levels
+void init(Water_Multigrid& mg, Mesh& water, const vec4* terrain)
+{
+	const char* state_define = water.state_format == GL_RG16F ? "#define HALF_STATE\n" : "";
+	const char* passes[6] = { "PREPARE", "SMOOTH", "RESIDUAL", "RESTRICT", "PROLONG", "FINISH" };
+	Compute_Shader* shaders[6] = { &mg.prepare, &mg.smooth, &mg.find_residual, &mg.restriction, &mg.prolongation, &mg.finish };
+
+	char defines[256] = {};
+	for (uint i = 0; i < 6; i++)
+	{
+		snprintf(defines, sizeof(defines), "%s#define %s\n", state_define, passes[i]);
+		load(shaders[i], "content/shaders/watermultigrid.comp", defines);
+	}
+
+	mg.num_levels = water_multigrid_dimensions(water.mesh_size + 1, mg.dimension);
+
+	// the masks are built on the cpu, the same way Water_Implicit_CPU does
+	Water_Multigrid_Level levels[WATER_MULTIGRID_MAX_LEVELS] = {};
+	for (uint l = 0; l < mg.num_levels; l++)
+	{
+		levels[l].dimension = mg.dimension[l];
+		levels[l].active    = Alloc(byte, mg.dimension[l] * mg.dimension[l]);
+	}
+
+	uint D = mg.dimension[0];
+	float* terrain_heights = Alloc(float, D * D);
+	for (uint i = 0; i < D * D; i++) terrain_heights[i] = terrain[i].y;
+
+	water_multigrid_masks(levels, mg.num_levels, terrain_heights);
+
+	for (uint l = 0; l < mg.num_levels; l++)
+	{
+		uint num_cells = mg.dimension[l] * mg.dimension[l];
+
+		uint* active = Alloc(uint, num_cells);
+		for (uint i = 0; i < num_cells; i++) active[i] = levels[l].active[i];
+
+		// x starts at 0 so the cells that are never solved for on the coarse levels stay at 0
+		float* zero = Alloc(float, num_cells);
+
+		glGenBuffers(1, &mg.x[l]);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mg.x[l]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * num_cells, zero, GL_DYNAMIC_COPY);
+
+		glGenBuffers(1, &mg.rhs[l]);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mg.rhs[l]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * num_cells, zero, GL_DYNAMIC_COPY);
+
+		glGenBuffers(1, &mg.residuals[l]);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mg.residuals[l]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * num_cells, zero, GL_DYNAMIC_COPY);
+
+		glGenBuffers(1, &mg.active[l]);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mg.active[l]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint) * num_cells, active, GL_STATIC_DRAW);
+
+		free(active);
+		free(zero);
+		free(levels[l].active);
+	}
+
+	glGenBuffers(1, &mg.residual_norm);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mg.residual_norm);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint), NULL, GL_DYNAMIC_READ);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	free(terrain_heights);
+}
+
+// temporal_steps > 1 runs that many steps per dispatch out of shared memory whenever a frame has enough
+// steps queued, it has no activity tracking so the tile scheduler is turned off with it.
+// implicit integrators solve over the whole grid every step, so they turn off both
+void init(Water_Simulation& sim, Mesh& water, Mesh& ground, bool use_tile_scheduler = true, uint temporal_steps = 1,
+	Water_Integrator integrator = WATER_EXPLICIT)
+{
+	bool implicit = integrator != WATER_EXPLICIT;
+
+	sim.dimension          = water.mesh_size + 1;
+	sim.tiles_per_side     = (sim.dimension + WATER_SIM_TILE_SIZE - 1) / WATER_SIM_TILE_SIZE;
+	sim.num_tiles          = sim.tiles_per_side * sim.tiles_per_side;
+	sim.integrator         = integrator;
+	sim.temporal_steps     = implicit ? 1 : glm::clamp(temporal_steps, 1u, (uint)WATER_MAX_TEMPORAL_STEPS);
+	sim.use_tile_scheduler = use_tile_scheduler && sim.temporal_steps == 1 && !implicit;
+
+	sim.substeps   = (uint)ceil(WATER_FIXED_TIMESTEP / water_max_time_step(sim.dimension));
+	sim.substep_dt = WATER_FIXED_TIMESTEP / sim.substeps;
+
+	// an implicit step longer than WATER_FIXED_TIMESTEP spans several frames, the water moves on the frame it lands on
+	if (implicit)
+	{
+		float explicit_dt = sim.substep_dt;
+		sim.substeps   = 1;
+		sim.substep_dt = WATER_IMPLICIT_STEP_MULTIPLE * water_max_time_step(sim.dimension);
+
+		print("water %s : %.4f s steps, %.1fx the explicit ones (%.4f s)\n", integrator == WATER_CRANK_NICOLSON ? "crank-nicolson" : "backward euler",
+			sim.substep_dt, sim.substep_dt / explicit_dt, explicit_dt);
+	}
+
+	const char* state_define = water.state_format == GL_RG16F ? "#define HALF_STATE\n" : "";
+
+	char defines[256] = {};
+	load(&sim.step, "content/shaders/watersimulation.comp", state_define);
+
+	snprintf(defines, sizeof(defines), "%s#define TILE_LIST\n#define WAKE_STEPS %d\n#define ACTIVITY_THRESHOLD %g\n",
+		state_define, WATER_TILE_WAKE_STEPS, WATER_ACTIVITY_THRESHOLD);
+	load(&sim.step_tiles, "content/shaders/watersimulation.comp", defines);
+
+	snprintf(defines, sizeof(defines), "#define TILE_SIZE %d\n#define RIPPLE_RADIUS %d\n", WATER_SIM_TILE_SIZE, WATER_RIPPLE_RADIUS);
+	load(&sim.schedule, "content/shaders/watertiles.comp", defines);
+
+	if (sim.temporal_steps > 1)
+	{
+		snprintf(defines, sizeof(defines), "%s#define TEMPORAL_STEPS %u\n", state_define, sim.temporal_steps);
+		load(&sim.step_temporal, "content/shaders/watertemporal.comp", defines);
+	}
+
+	// static wet mask from the terrain, dry tiles are never scheduled
+	uint D = sim.dimension;
+	vec4* terrain = Alloc(vec4, D * D);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ground.positions);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(vec4) * D * D, terrain);
+
+	uint* wet      = Alloc(uint, sim.num_tiles);
+	uint* activity = Alloc(uint, sim.num_tiles);
+
+	for (uint y = 1; y < D - 1; y++) {
+	for (uint x = 1; x < D - 1; x++)
+	{
+		if (terrain[(y * D) + x].y >= 0) continue;
+
+		uint tile = ((y / WATER_SIM_TILE_SIZE) * sim.tiles_per_side) + (x / WATER_SIM_TILE_SIZE);
+		wet     [tile] = 1;
+		activity[tile] = WATER_TILE_WAKE_STEPS; // everything wet runs until it has settled once
+	} }
+
+	glGenBuffers(1, &sim.tile_wet);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sim.tile_wet);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint) * sim.num_tiles, wet, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &sim.tile_activity);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sim.tile_activity);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint) * sim.num_tiles, activity, GL_DYNAMIC_COPY);
+
+	glGenBuffers(1, &sim.tile_list);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sim.tile_list);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint) * sim.num_tiles, NULL, GL_DYNAMIC_COPY);
+
+	Dispatch_Indirect_Command args = { 0, 1, 1 };
+	glGenBuffers(1, &sim.dispatch_args);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sim.dispatch_args);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(args), &args, GL_DYNAMIC_COPY);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	if (implicit) init(sim.multigrid, water, terrain);
+
+	free(terrain);
+	free(wet);
+	free(activity);
+}
+
+// waves are absorbed in the last sponge_width cells instead of reflecting off the edge,
+// so an open water grid doesn't have to be much bigger than what is in view
+void water_simulation_set_sponge(Water_Simulation& sim, uint sponge_width)
+{
+	sim.sponge_width    = sponge_width;
+	sim.sponge_strength = water_sponge_strength(sim.dimension, sponge_width);
+}
+
+// binds the program, its uniforms & every buffer the simulation shaders use
+void water_simulation_bind(Water_Simulation& sim, Compute_Shader shader, Mesh& water, Mesh& ground, float dt, float time)
+{
+	glUseProgram(shader.id);
+
+	glUniform1i(0, sim.dimension);
+	glUniform1f(2, time         );
+
+	// not every program declares the rest, the ones that don't are at -1 & skipped
+	glUniform1f(glGetUniformLocation(shader.id, "DeltaTime"     ), dt                 );
+	glUniform1i(glGetUniformLocation(shader.id, "TilesPerSide"  ), sim.tiles_per_side );
+	glUniform1i(glGetUniformLocation(shader.id, "SpongeWidth"   ), sim.sponge_width   );
+	glUniform1f(glGetUniformLocation(shader.id, "SpongeStrength"), sim.sponge_strength);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, water.state[water.current    ]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, water.state[water.current ^ 1]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, water.normals     );
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, ground.positions  );
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, sim.tile_wet      );
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, sim.tile_activity );
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, sim.tile_list     );
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, sim.dispatch_args );
+}
+
+// binds a multigrid pass over level l, & level l + 1 below it for the passes that move between levels
+void water_multigrid_bind(Water_Multigrid& mg, Compute_Shader shader, uint l, float coupling)
+{
+	glUseProgram(shader.id);
+
+	glUniform1i(0, mg.dimension[l]);
+	glUniform1f(3, coupling       );
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, mg.x        [l]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, mg.rhs      [l]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, mg.active   [l]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, mg.residuals[l]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, mg.residual_norm);
+
+	if (l + 1 < mg.num_levels)
+	{
+		glUniform1i(5, mg.dimension[l + 1]);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mg.x     [l + 1]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mg.rhs   [l + 1]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mg.active[l + 1]);
+	}
+}
+
+// every pass reads what the one before it wrote
+void water_multigrid_dispatch(uint dimension)
+{
+	uint num_groups = (dimension + WATER_SIM_TILE_SIZE - 1) / WATER_SIM_TILE_SIZE;
+	glDispatchCompute(num_groups, num_groups, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void water_multigrid_smooth(Water_Multigrid& mg, uint l, float coupling, uint sweeps)
+{
+	water_multigrid_bind(mg, mg.smooth, l, coupling);
+
+	for (uint s = 0; s < sweeps; s++)
+	for (uint color = 0; color < 2; color++)
+	{
+		glUniform1i(4, color);
+		water_multigrid_dispatch(mg.dimension[l]);
+	}
+}
+
+void water_multigrid_v_cycle(Water_Multigrid& mg, uint l, uint num_levels, float coupling)
+{
+	if (l + 1 == num_levels)
+	{
+		water_multigrid_smooth(mg, l, coupling, WATER_MULTIGRID_COARSE_SMOOTH);
+		return;
+	}
+
+	water_multigrid_smooth(mg, l, coupling, WATER_MULTIGRID_PRE_SMOOTH);
+
+	water_multigrid_bind(mg, mg.find_residual, l, coupling);
+	water_multigrid_dispatch(mg.dimension[l]);
+	water_multigrid_bind(mg, mg.restriction, l, coupling);
+	water_multigrid_dispatch(mg.dimension[l + 1]);
+
+	// twice the spacing on the next level : a / 4
+	water_multigrid_v_cycle(mg, l + 1, num_levels, coupling * 0.25f);
+
+	water_multigrid_bind(mg, mg.prolongation, l, coupling);
+	water_multigrid_dispatch(mg.dimension[l]);
+
+	water_multigrid_smooth(mg, l, coupling, WATER_MULTIGRID_POST_SMOOTH);
+}
+
+// binds PREPARE or FINISH, they work on the state of the finest level
+void water_multigrid_bind_state(Water_Multigrid& mg, Compute_Shader shader, Mesh& water, float dt, float time)
+{
+	water_multigrid_bind(mg, shader, 0, 0);
+
+	glUniform1f(1, dt  );
+	glUniform1f(2, time);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, water.state[water.current    ]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, water.state[water.current ^ 1]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, water.normals);
+}
+
+// one implicit step (see water_step_implicit()) from water.state[current] into the other state buffer, then flips current.
+// the residual is read back after every V-cycle, so this waits on the gpu a few times per step
+void water_simulation_step_implicit(Water_Simulation& sim, Mesh& water, float dt, float time)
+{
+	Water_Multigrid& mg = sim.multigrid;
+
+	float h = 2.f / float(sim.dimension); // grid spacing used by the shader
+	float stiffness = (WATER_WAVE_SPEED * WATER_WAVE_SPEED) / (h * h);
+	float theta = water_integrator_theta(sim.integrator);
+	float a = theta * theta * dt * dt * stiffness;
+	float b = theta * (1.f - theta) * dt * dt * stiffness;
+
+	water_multigrid_bind_state(mg, mg.prepare, water, dt, time);
+	glUniform1f(6, b);
+	water_multigrid_dispatch(sim.dimension);
+
+	uint num_levels = water_multigrid_num_levels(mg.num_levels, a);
+	mg.cycles   = 0;
+	mg.residual = 0;
+
+	while (mg.cycles < WATER_MULTIGRID_MAX_CYCLES)
+	{
+		water_multigrid_v_cycle(mg, 0, num_levels, a);
+		mg.cycles++;
+
+		GLuint zero = 0;
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mg.residual_norm);
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+		water_multigrid_bind(mg, mg.find_residual, 0, a);
+		water_multigrid_dispatch(sim.dimension);
+
+		float norm = 0;
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mg.residual_norm);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(float), &norm); // float bits
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		mg.residual = norm / (1.f + 4.f * a);
+		if (mg.residual <= WATER_MULTIGRID_TOLERANCE) break;
+	}
+
+	water_multigrid_bind_state(mg, mg.finish, water, dt, time);
+	glUniform1f(7, theta);
+	glUniform1f(8, pow(WATER_ATTENUATION, dt / WATER_TUNED_STEP)); // the same per second as the explicit step
+	glUniform1f(9, dt / WATER_TUNED_STEP);
+	glUniform1i(10, sim.sponge_width   );
+	glUniform1f(11, sim.sponge_strength);
+
+	uint num_groups = (sim.dimension + WATER_SIM_TILE_SIZE - 1) / WATER_SIM_TILE_SIZE;
+	glDispatchCompute(num_groups, num_groups, 1);
+
+	water.current ^= 1;
+}
+
+// one step from water.state[current] into the other state buffer, then flips current
+void water_simulation_step(Water_Simulation& sim, Mesh& water, Mesh& ground, float dt, float time)
+{
+	if (sim.integrator != WATER_EXPLICIT)
+	{
+		water_simulation_step_implicit(sim, water, dt, time);
+		return;
+	}
+
+	if (sim.use_tile_scheduler)
+	{
+		Dispatch_Indirect_Command reset = { 0, 1, 1 };
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, sim.dispatch_args);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(reset), &reset);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		water_simulation_bind(sim, sim.schedule, water, ground, dt, time);
+		glDispatchCompute((sim.num_tiles + 63) / 64, 1, 1);
+
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+		water_simulation_bind(sim, sim.step_tiles, water, ground, dt, time);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, sim.dispatch_args);
+		glDispatchComputeIndirect(0);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+	}
+	else
+	{
+		water_simulation_bind(sim, sim.step, water, ground, dt, time);
+		glDispatchCompute(sim.tiles_per_side, sim.tiles_per_side, 1);
+	}
+
+	water.current ^= 1;
+}
+
+// temporal_steps steps from water.state[current] into the other state buffer, then flips current
+void water_simulation_step_temporal(Water_Simulation& sim, Mesh& water, Mesh& ground, float dt, float time)
+{
+	water_simulation_bind(sim, sim.step_temporal, water, ground, dt, time);
+	glDispatchCompute(sim.tiles_per_side, sim.tiles_per_side, 1);
+
+	water.current ^= 1;
+}
+
+// advances the simulation by frame_time in substep_dt steps, returns how many steps ran.
+// every step goes out back to back with no cpu sync in between. steps only wait on each other's
+// storage writes, so does the chunk culling after the last one. the render graph waits for the vertex reads
+uint water_simulation_update(Water_Simulation& sim, Mesh& water, Mesh& ground, float frame_time)
+{
+	sim.accumulator += frame_time;
+
+	uint num_steps = (uint)(sim.accumulator / sim.substep_dt);
+	if (num_steps > WATER_MAX_SUBSTEPS)
+	{
+		num_steps = WATER_MAX_SUBSTEPS;
+		sim.accumulator = 0; // too far behind, slow the water down instead of spiraling
+	}
+	else sim.accumulator -= num_steps * sim.substep_dt;
+
+	for (uint i = 0; i < num_steps;)
+	{
+		if (i > 0) glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		uint steps = 1;
+		if (sim.temporal_steps > 1 && num_steps - i >= sim.temporal_steps)
+		{
+			steps = sim.temporal_steps;
+			water_simulation_step_temporal(sim, water, ground, sim.substep_dt, sim.time);
+		}
+		else water_simulation_step(sim, water, ground, sim.substep_dt, sim.time);
+
+		sim.time += steps * sim.substep_dt;
+		i += steps;
+	}
+
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	return num_steps;
+}
+
+// same as water_simulation_step() but also runs the step on the cpu & compares the two
+void water_simulation_compare(Water_Simulation& sim, Water_CPU& water_cpu, Mesh& water, Mesh& ground, float dt, float time)
+{
+	// the steps of the last frame may still be writing the state it reads back
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	water_simulation_bind(sim, sim.step, water, ground, dt, time);
+	water_compare_gpu(water_cpu, water.state[water.current], water.state[water.current ^ 1], water.state_format, water.normals, dt, time);
+
+	water.current ^= 1;
+}
+
+// same as water_simulation_step_implicit() but also runs the step with the cpu multigrid & compares the two
+bool water_simulation_compare_implicit(Water_Simulation& sim, Water_CPU& water_cpu, Water_Implicit_CPU& implicit_cpu,
+	Mesh& water, float dt, float time, float tolerance = 1e-4f)
+{
+	uint D = sim.dimension;
+	vec2* state   = Alloc(vec2, D * D);
+	vec4* normals = Alloc(vec4, D * D);
+
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	read_state_buffer(water.state[water.current], water.state_format, state, D * D);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, water.normals);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(vec4) * D * D, normals);
+
+	water_write_state(water_cpu, state, normals);
+	water_step_implicit(water_cpu, implicit_cpu, dt, time);
+
+	water_simulation_step_implicit(sim, water, dt, time);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	read_state_buffer(water.state[water.current], water.state_format, state, D * D);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, water.normals);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(vec4) * D * D, normals);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// the cpu keeps full floats, so half state only matches to ~3 digits
+	if (water.state_format == GL_RG16F) tolerance = glm::max(tolerance, 1e-3f);
+
+	print("water implicit : gpu %u cycles (residual %g), cpu %u cycles (residual %g)\n",
+		sim.multigrid.cycles, sim.multigrid.residual, implicit_cpu.cycles, implicit_cpu.residual);
+	bool match = water_compare(water_cpu, state, normals, tolerance);
+
+	free(state);
+	free(normals);
+	return match;
+}
+
+// runs temporal_steps single steps & one temporal dispatch from the current state into scratch buffers
+// & prints how far apart they end up, the water itself is left alone
+bool water_simulation_compare_temporal(Water_Simulation& sim, Mesh& water, Mesh& ground, float dt, float time, float tolerance = 1e-5f)
+{
+	if (sim.temporal_steps < 2) return true;
+
+	uint D = sim.dimension;
+	GLsizeiptr state_bytes  = state_size(water.state_format) * D * D;
+	GLsizeiptr normal_bytes = sizeof(vec4) * D * D;
+
+	// [0, 1] ping-pong for the single steps, [2] output of the temporal step
+	GLuint states[3], normals[2];
+	glGenBuffers(3, states);
+	glGenBuffers(2, normals);
+
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	for (uint i = 0; i < 3; i++)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, states[i]);
+		glBufferData(GL_COPY_WRITE_BUFFER, state_bytes, NULL, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_COPY_READ_BUFFER, water.state[water.current]);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, state_bytes);
+	}
+	for (uint i = 0; i < 2; i++)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, normals[i]);
+		glBufferData(GL_COPY_WRITE_BUFFER, normal_bytes, NULL, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_COPY_READ_BUFFER, water.normals);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, normal_bytes);
+	}
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	Mesh single = water;
+	single.state[0] = states[0];
+	single.state[1] = states[1];
+	single.normals  = normals[0];
+	single.current  = 0;
+
+	for (uint i = 0; i < sim.temporal_steps; i++)
+	{
+		water_simulation_bind(sim, sim.step, single, ground, dt, time + i * dt);
+		glDispatchCompute(sim.tiles_per_side, sim.tiles_per_side, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		single.current ^= 1;
+	}
+
+	Mesh temporal = water;
+	temporal.state[1] = states[2];
+	temporal.normals  = normals[1];
+	temporal.current  = 0;
+	temporal.state[0] = water.state[water.current]; // only read
+
+	water_simulation_step_temporal(sim, temporal, ground, dt, time);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	vec2* single_state    = Alloc(vec2, D * D);
+	vec2* temporal_state  = Alloc(vec2, D * D);
+	vec4* single_normal   = Alloc(vec4, D * D);
+	vec4* temporal_normal = Alloc(vec4, D * D);
+
+	read_state_buffer(single.state[single.current], water.state_format, single_state  , D * D);
+	read_state_buffer(states[2]                   , water.state_format, temporal_state, D * D);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, normals[0]);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, normal_bytes, single_normal);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, normals[1]);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, normal_bytes, temporal_normal);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	float state_error = 0, normal_error = 0;
+	for (uint i = 0; i < D * D; i++)
+	{
+		vec2 ds = glm::abs(single_state [i] - temporal_state [i]);
+		vec4 dn = glm::abs(single_normal[i] - temporal_normal[i]);
+		state_error  = glm::max(state_error , glm::max(ds.x, ds.y));
+		normal_error = glm::max(normal_error, glm::max(glm::max(dn.x, dn.y), dn.z));
+	}
+
+	// the single steps round to half precision in between, the temporal kernel only at the end
+	if (water.state_format == GL_RG16F) tolerance = glm::max(tolerance, 1e-3f);
+
+	bool match = state_error <= tolerance && normal_error <= tolerance;
+	print("water temporal x%u vs single step : state %g, normals %g -> %s\n",
+		sim.temporal_steps, state_error, normal_error, match ? "match" : "MISMATCH");
+
+	free(single_state);
+	free(temporal_state);
+	free(single_normal);
+	free(temporal_normal);
+	glDeleteBuffers(3, states);
+	glDeleteBuffers(2, normals);
+
+	return match;
+}
@@ -0,0 +1,646 @@
+// CPU version of content/shaders/watersimulation.comp
+// used on machines without a gpu & as ground truth for the gpu results
+
+#include <chrono>
+#include "external/GLM/gtc/packing.hpp" // unpackHalf2x16
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define WATER_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define WATER_SIMD_WIDTH 4
+#else
+	#define WATER_SIMD_WIDTH 1
+#endif
+
+// these have to match watersimulation.comp
+#define WATER_WAVE_SPEED    0.1f
+#define WATER_ATTENUATION   0.997f     // of the velocity per WATER_TUNED_STEP
+#define WATER_TUNED_STEP    (1.f / 60) // the step the attenuation & the ripple strength are per
+#define WATER_RIPPLE_PERIOD 8
+#define WATER_SIM_TILE_SIZE 16 // workgroup size, TILE_SIZE in the shader
+
+// the ripple is exp(-r/2), past this many cells it is smaller than a float can add to the surface
+#define WATER_RIPPLE_RADIUS 40
+
+// absorbing layer along the edge of the grid : waves that cross it & come back are this much smaller in theory.
+// the damping ramp itself reflects a little too, stronger layers only make that worse
+#define WATER_SPONGE_REFLECTION 0.03f
+
+// parallel mode splits the interior into tiles of about this many bytes of state (~L2 per core).
+// a tile reads one halo row above & below it from the previous state, which nobody writes during a step
+#define WATER_TILE_CACHE_BYTES (256 * 1024)
+#define WATER_TILE_MAX_WIDTH   2048
+#define WATER_BYTES_PER_CELL   (8 * sizeof(float)) // height & velocity x2, terrain, normal xyz
+
+struct Water_CPU
+{
+	uint dimension; // cells per side (mesh_size + 1)
+
+	// ping-pong like Mesh::positions[0/1], [current] is the latest state
+	float* height  [2];
+	float* velocity[2];
+	uint current;
+
+	float* terrain; // terrain height per cell, water is only simulated where this is < 0
+	float* normal_x;
+	float* normal_y;
+	float* normal_z;
+
+	bool use_simd;
+
+	// absorbing layer along the edge, 0 = the edge reflects
+	uint  sponge_width;    // in cells
+	float sponge_strength; // velocity damping rate (1 / s) at the edge
+
+	// parallel mode
+	Thread_Pool* pool;
+	uint tile_width, tile_height; // in cells
+	uint tiles_x, tiles_y;
+	bool huge_pages;
+};
+
+// everything a row needs for one step
+struct Water_CPU_Step
+{
+	const float* height;
+	const float* velocity;
+	const float* terrain;
+	float* new_height;
+	float* new_velocity;
+	float* normal_x;
+	float* normal_y;
+	float* normal_z;
+
+	uint  dimension;
+	float delta_time;
+	float stiffness; // c^2 / h^2
+	float damping;   // WATER_ATTENUATION over delta_time
+	float spacing;   // distance between the -1 & +1 neighbours on the mesh
+};
+
+void water_tile_bounds(Water_CPU& water, uint tile, uint* x0, uint* y0, uint* x1, uint* y1)
+{
+	uint interior = water.dimension - 1; // cells [1, interior) are simulated
+
+	*x0 = 1 + (tile % water.tiles_x) * water.tile_width;
+	*y0 = 1 + (tile / water.tiles_x) * water.tile_height;
+	*x1 = glm::min(*x0 + water.tile_width , interior);
+	*y1 = glm::min(*y0 + water.tile_height, interior);
+}
+
+struct Water_CPU_Init
+{
+	Water_CPU* water;
+	const float* terrain_heights;
+};
+
+// every tile zeroes its own cells so the pages end up on the numa node of the thread that steps them
+void water_first_touch_job(uint tile, uint thread_index, void* params)
+{
+	Water_CPU_Init* init = (Water_CPU_Init*)params;
+	Water_CPU& water = *init->water;
+	uint D = water.dimension;
+
+	uint x0, y0, x1, y1;
+	water_tile_bounds(water, tile, &x0, &y0, &x1, &y1);
+
+	// tiles on the edge also own the border cells next to them
+	if (x0 == 1) x0 = 0;
+	if (y0 == 1) y0 = 0;
+	if (x1 == D - 1) x1 = D;
+	if (y1 == D - 1) y1 = D;
+
+	for (uint y = y0; y < y1; y++) {
+	for (uint x = x0; x < x1; x++)
+	{
+		uint i = (y * D) + x;
+		water.height  [0][i] = water.height  [1][i] = 0;
+		water.velocity[0][i] = water.velocity[1][i] = 0;
+		water.terrain [i] = init->terrain_heights ? init->terrain_heights[i] : -1.f;
+		water.normal_x[i] = 0;
+		water.normal_y[i] = 1;
+		water.normal_z[i] = 0;
+	} }
+}
+
+// pool = NULL runs single threaded, huge_pages is a hint
+void init(Water_CPU& water, uint dimension, const float* terrain_heights = NULL, Thread_Pool* pool = NULL, bool huge_pages = false)
+{
+	uint num_cells = dimension * dimension;
+	size_t grid_size = sizeof(float) * num_cells;
+
+	water.dimension  = dimension;
+	water.current    = 0;
+	water.use_simd   = WATER_SIMD_WIDTH > 1;
+	water.pool       = pool;
+	water.huge_pages = huge_pages;
+
+	uint interior = dimension - 2;
+	water.tile_width  = glm::min(interior, (uint)WATER_TILE_MAX_WIDTH);
+	water.tile_height = glm::max(4u, (uint)(WATER_TILE_CACHE_BYTES / (WATER_BYTES_PER_CELL * water.tile_width)));
+	water.tiles_x = (interior + water.tile_width  - 1) / water.tile_width;
+	water.tiles_y = (interior + water.tile_height - 1) / water.tile_height;
+
+	// nothing is touched here, see water_first_touch_job()
+	water.height  [0] = (float*)os_alloc(grid_size, huge_pages);
+	water.height  [1] = (float*)os_alloc(grid_size, huge_pages);
+	water.velocity[0] = (float*)os_alloc(grid_size, huge_pages);
+	water.velocity[1] = (float*)os_alloc(grid_size, huge_pages);
+	water.terrain     = (float*)os_alloc(grid_size, huge_pages);
+	water.normal_x    = (float*)os_alloc(grid_size, huge_pages);
+	water.normal_y    = (float*)os_alloc(grid_size, huge_pages);
+	water.normal_z    = (float*)os_alloc(grid_size, huge_pages);
+
+	Water_CPU_Init params = { &water, terrain_heights };
+	parallel_for(pool, water.tiles_x * water.tiles_y, water_first_touch_job, &params, true);
+}
+void free(Water_CPU& water)
+{
+	size_t grid_size = sizeof(float) * water.dimension * water.dimension;
+
+	os_free(water.height  [0], grid_size);
+	os_free(water.height  [1], grid_size);
+	os_free(water.velocity[0], grid_size);
+	os_free(water.velocity[1], grid_size);
+	os_free(water.terrain    , grid_size);
+	os_free(water.normal_x   , grid_size);
+	os_free(water.normal_y   , grid_size);
+	os_free(water.normal_z   , grid_size);
+	water = {};
+}
+
+// updates cells [x0, x1) of row y, cells that are dry keep their old state
+void water_step_row_scalar(const Water_CPU_Step& step, uint y, uint x0, uint x1)
+{
+	uint D = step.dimension;
+
+	for (uint x = x0; x < x1; x++)
+	{
+		uint index = (y * D) + x;
+		if (step.terrain[index] >= 0) continue;
+
+		float h = step.height  [index];
+		float v = step.velocity[index];
+
+		float left  = step.height[index - 1];
+		float right = step.height[index + 1];
+		float down  = step.height[index - D];
+		float up    = step.height[index + D];
+
+		// f = c^2 * (u[i+1, j] + u[i-1, j] + u[i, j+1] + u[i, j-1] - 4u[i, j]) / h^2
+		float f = step.stiffness * (left + right + down + up - 4.f * h);
+
+		v += f * step.delta_time;
+		h += v * step.delta_time;
+		v *= step.damping;
+
+		step.new_height  [index] = h;
+		step.new_velocity[index] = v;
+
+		// the shader sums 4 cross products of the neighbour positions,
+		// which is the same as cross(right - left, up - down)
+		float ax = right - left;
+		float by = up - down;
+		float inv_length = 1.f / sqrt(ax * ax + by * by + step.spacing * step.spacing);
+
+		step.normal_x[index] = -by * inv_length;
+		step.normal_y[index] = step.spacing * inv_length;
+		step.normal_z[index] = -ax * inv_length;
+	}
+}
+
+#if WATER_SIMD_WIDTH == 8
+
+void water_step_row_simd(const Water_CPU_Step& step, uint y, uint x0, uint x1)
+{
+	uint D = step.dimension;
+	uint x = x0;
+
+	__m256 zero      = _mm256_setzero_ps();
+	__m256 four      = _mm256_set1_ps(4.f);
+	__m256 one       = _mm256_set1_ps(1.f);
+	__m256 dt        = _mm256_set1_ps(step.delta_time);
+	__m256 stiffness = _mm256_set1_ps(step.stiffness);
+	__m256 damping   = _mm256_set1_ps(step.damping);
+	__m256 spacing   = _mm256_set1_ps(step.spacing);
+	__m256 spacing2  = _mm256_set1_ps(step.spacing * step.spacing);
+
+	for (; x + 8 <= x1; x += 8)
+	{
+		uint index = (y * D) + x;
+
+		__m256 wet = _mm256_cmp_ps(_mm256_loadu_ps(step.terrain + index), zero, _CMP_LT_OQ);
+		if (_mm256_movemask_ps(wet) == 0) continue;
+
+		__m256 h     = _mm256_loadu_ps(step.height   + index);
+		__m256 v     = _mm256_loadu_ps(step.velocity + index);
+		__m256 left  = _mm256_loadu_ps(step.height   + index - 1);
+		__m256 right = _mm256_loadu_ps(step.height   + index + 1);
+		__m256 down  = _mm256_loadu_ps(step.height   + index - D);
+		__m256 up    = _mm256_loadu_ps(step.height   + index + D);
+
+		__m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(left, right), down), up);
+		__m256 f   = _mm256_mul_ps(stiffness, _mm256_sub_ps(sum, _mm256_mul_ps(four, h)));
+
+		__m256 new_v = _mm256_add_ps(v, _mm256_mul_ps(f, dt));
+		__m256 new_h = _mm256_add_ps(h, _mm256_mul_ps(new_v, dt));
+		new_v = _mm256_mul_ps(new_v, damping);
+
+		_mm256_storeu_ps(step.new_height   + index, _mm256_blendv_ps(h, new_h, wet));
+		_mm256_storeu_ps(step.new_velocity + index, _mm256_blendv_ps(v, new_v, wet));
+
+		__m256 ax = _mm256_sub_ps(right, left);
+		__m256 by = _mm256_sub_ps(up, down);
+		__m256 length2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, ax), _mm256_mul_ps(by, by)), spacing2);
+		__m256 inv_length = _mm256_div_ps(one, _mm256_sqrt_ps(length2));
+
+		__m256 nx = _mm256_mul_ps(_mm256_sub_ps(zero, by), inv_length);
+		__m256 ny = _mm256_mul_ps(spacing, inv_length);
+		__m256 nz = _mm256_mul_ps(_mm256_sub_ps(zero, ax), inv_length);
+
+		_mm256_storeu_ps(step.normal_x + index, _mm256_blendv_ps(_mm256_loadu_ps(step.normal_x + index), nx, wet));
+		_mm256_storeu_ps(step.normal_y + index, _mm256_blendv_ps(_mm256_loadu_ps(step.normal_y + index), ny, wet));
+		_mm256_storeu_ps(step.normal_z + index, _mm256_blendv_ps(_mm256_loadu_ps(step.normal_z + index), nz, wet));
+	}
+
+	water_step_row_scalar(step, y, x, x1);
+}
+
+#elif WATER_SIMD_WIDTH == 4
+
+// sse2 has no blendv
+inline __m128 select_ps(__m128 mask, __m128 a, __m128 b) // mask ? b : a
+{
+	return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+void water_step_row_simd(const Water_CPU_Step& step, uint y, uint x0, uint x1)
+{
+	uint D = step.dimension;
+	uint x = x0;
+
+	__m128 zero      = _mm_setzero_ps();
+	__m128 four      = _mm_set1_ps(4.f);
+	__m128 one       = _mm_set1_ps(1.f);
+	__m128 dt        = _mm_set1_ps(step.delta_time);
+	__m128 stiffness = _mm_set1_ps(step.stiffness);
+	__m128 damping   = _mm_set1_ps(step.damping);
+	__m128 spacing   = _mm_set1_ps(step.spacing);
+	__m128 spacing2  = _mm_set1_ps(step.spacing * step.spacing);
+
+	for (; x + 4 <= x1; x += 4)
+	{
+		uint index = (y * D) + x;
+
+		__m128 wet = _mm_cmplt_ps(_mm_loadu_ps(step.terrain + index), zero);
+		if (_mm_movemask_ps(wet) == 0) continue;
+
+		__m128 h     = _mm_loadu_ps(step.height   + index);
+		__m128 v     = _mm_loadu_ps(step.velocity + index);
+		__m128 left  = _mm_loadu_ps(step.height   + index - 1);
+		__m128 right = _mm_loadu_ps(step.height   + index + 1);
+		__m128 down  = _mm_loadu_ps(step.height   + index - D);
+		__m128 up    = _mm_loadu_ps(step.height   + index + D);
+
+		__m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(left, right), down), up);
+		__m128 f   = _mm_mul_ps(stiffness, _mm_sub_ps(sum, _mm_mul_ps(four, h)));
+
+		__m128 new_v = _mm_add_ps(v, _mm_mul_ps(f, dt));
+		__m128 new_h = _mm_add_ps(h, _mm_mul_ps(new_v, dt));
+		new_v = _mm_mul_ps(new_v, damping);
+
+		_mm_storeu_ps(step.new_height   + index, select_ps(wet, h, new_h));
+		_mm_storeu_ps(step.new_velocity + index, select_ps(wet, v, new_v));
+
+		__m128 ax = _mm_sub_ps(right, left);
+		__m128 by = _mm_sub_ps(up, down);
+		__m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ax), _mm_mul_ps(by, by)), spacing2);
+		__m128 inv_length = _mm_div_ps(one, _mm_sqrt_ps(length2));
+
+		__m128 nx = _mm_mul_ps(_mm_sub_ps(zero, by), inv_length);
+		__m128 ny = _mm_mul_ps(spacing, inv_length);
+		__m128 nz = _mm_mul_ps(_mm_sub_ps(zero, ax), inv_length);
+
+		_mm_storeu_ps(step.normal_x + index, select_ps(wet, _mm_loadu_ps(step.normal_x + index), nx));
+		_mm_storeu_ps(step.normal_y + index, select_ps(wet, _mm_loadu_ps(step.normal_y + index), ny));
+		_mm_storeu_ps(step.normal_z + index, select_ps(wet, _mm_loadu_ps(step.normal_z + index), nz));
+	}
+
+	water_step_row_scalar(step, y, x, x1);
+}
+
+#else
+
+void water_step_row_simd(const Water_CPU_Step& step, uint y, uint x0, uint x1)
+{
+	water_step_row_scalar(step, y, x0, x1);
+}
+
+#endif
+
+Water_CPU_Step water_step_params(Water_CPU& water, float dt)
+{
+	uint D = water.dimension;
+	uint prev = water.current;
+	uint next = prev ^ 1;
+
+	float h = 2.f / float(D); // grid spacing used by the shader
+
+	Water_CPU_Step step = {};
+	step.height       = water.height  [prev];
+	step.velocity     = water.velocity[prev];
+	step.terrain      = water.terrain;
+	step.new_height   = water.height  [next];
+	step.new_velocity = water.velocity[next];
+	step.normal_x     = water.normal_x;
+	step.normal_y     = water.normal_y;
+	step.normal_z     = water.normal_z;
+	step.dimension    = D;
+	step.delta_time   = dt;
+	step.stiffness    = (WATER_WAVE_SPEED * WATER_WAVE_SPEED) / (h * h);
+	step.damping      = pow(WATER_ATTENUATION, dt / WATER_TUNED_STEP);
+	step.spacing      = 2.f / float(D - 1);
+
+	return step;
+}
+
+// rate at which the velocity is damped at the edge of a sponge_width layer, it ramps up quadratically from the
+// inner side. the amplitude decays at half that, so a wave crossing the layer twice keeps exp(-strength * width / 3c)
+float water_sponge_strength(uint dimension, uint sponge_width)
+{
+	if (sponge_width == 0) return 0;
+
+	float h = 2.f / float(dimension); // grid spacing used by the shader
+	float cells_per_second = WATER_WAVE_SPEED / h;
+	return 3.f * cells_per_second * log(1.f / WATER_SPONGE_REFLECTION) / sponge_width;
+}
+
+// the same layer has to be set on the gpu simulation to compare against it
+void water_set_sponge(Water_CPU& water, uint sponge_width)
+{
+	water.sponge_width    = sponge_width;
+	water.sponge_strength = water_sponge_strength(water.dimension, sponge_width);
+}
+
+// factor for the velocity of a cell after a step of dt, 1 outside the layer
+float water_sponge_factor(uint dimension, uint sponge_width, float sponge_strength, uint x, uint y, float dt)
+{
+	uint edge = glm::min(glm::min(x, y), glm::min(dimension - 1 - x, dimension - 1 - y));
+	if (edge >= sponge_width) return 1.f;
+
+	float t = 1.f - float(edge) / float(sponge_width);
+	return exp(-sponge_strength * t * t * dt);
+}
+
+// damps the velocity of the wet cells in the layer, the rest of the grid is never touched.
+// damping the height as well pulls the surface back down in the layer, which reflects more
+void water_apply_sponge(Water_CPU& water, float dt)
+{
+	uint D = water.dimension;
+	uint W = water.sponge_width;
+	if (W == 0) return;
+
+	float* velocity = water.velocity[water.current];
+
+	for (uint y = 1; y + 1 < D; y++)
+	{
+		bool band_row = glm::min(y, D - 1 - y) < W;
+
+		for (uint x = 1; x + 1 < D; x++)
+		{
+			// rows outside the band only have the cells on their two ends in it
+			if (!band_row && x == W) x = glm::max(W, D - 1 - W);
+
+			uint index = (y * D) + x;
+			if (water.terrain[index] >= 0) continue;
+
+			velocity[index] *= water_sponge_factor(D, W, water.sponge_strength, x, y, dt);
+		}
+	}
+}
+
+// pulling up some water, every WATER_RIPPLE_PERIOD seconds. strength is the length of the step in WATER_TUNED_STEPs
+void water_add_ripple(Water_CPU& water, float time, float strength = 1.f)
+{
+	if (int(time) % WATER_RIPPLE_PERIOD != 0) return;
+
+	uint D = water.dimension;
+	float* height = water.height[water.current];
+
+	vec2 ripple_position = vec2(D * 0.3f, D * 0.6f);
+	float scale = strength * 0.025f / sqrt(6.28f);
+
+	int x0 = glm::max(1, int(ripple_position.x) - WATER_RIPPLE_RADIUS), x1 = glm::min(int(D) - 1, int(ripple_position.x) + WATER_RIPPLE_RADIUS);
+	int y0 = glm::max(1, int(ripple_position.y) - WATER_RIPPLE_RADIUS), y1 = glm::min(int(D) - 1, int(ripple_position.y) + WATER_RIPPLE_RADIUS);
+
+	for (int y = y0; y < y1; y++) {
+	for (int x = x0; x < x1; x++)
+	{
+		uint index = (y * D) + x;
+		if (water.terrain[index] >= 0) continue;
+
+		float ripple = exp(-(1.f / 2) * glm::length(vec2(x, y) - ripple_position));
+		height[index] += scale * ripple;
+	} }
+}
+
+struct Water_CPU_Tile_Step
+{
+	Water_CPU* water;
+	Water_CPU_Step step;
+};
+
+void water_step_tile_job(uint tile, uint thread_index, void* params)
+{
+	Water_CPU_Tile_Step* tile_step = (Water_CPU_Tile_Step*)params;
+	Water_CPU& water = *tile_step->water;
+
+	uint x0, y0, x1, y1;
+	water_tile_bounds(water, tile, &x0, &y0, &x1, &y1);
+
+	for (uint y = y0; y < y1; y++)
+	{
+		if (water.use_simd) water_step_row_simd  (tile_step->step, y, x0, x1);
+		else                water_step_row_scalar(tile_step->step, y, x0, x1);
+	}
+}
+
+void water_step(Water_CPU& water, float dt, float time)
+{
+	Water_CPU_Tile_Step params = { &water, water_step_params(water, dt) };
+
+	// static schedule : a tile is always stepped by the thread that first touched it
+	parallel_for(water.pool, water.tiles_x * water.tiles_y, water_step_tile_job, &params, true);
+
+	water.current ^= 1;
+	water_apply_sponge(water, dt);
+	water_add_ripple(water, time, dt / WATER_TUNED_STEP);
+}
+
+// same layout as the Mesh buffers : vec4(x, height, z, velocity) & vec4(normal, 0)
+void water_read_positions(Water_CPU& water, vec4* positions, vec4* normals = NULL)
+{
+	uint D = water.dimension;
+	float resolution = float(D - 1);
+
+	for (uint i = 0; i < D * D; i++)
+	{
+		// create_mesh() walks x in the outer loop, so the gpu index (y * D + x) is mesh (x, y) swapped
+		positions[i] = vec4((i / D) / resolution, water.height[water.current][i], (i % D) / resolution, water.velocity[water.current][i]);
+		if (normals) normals[i] = vec4(water.normal_x[i], water.normal_y[i], water.normal_z[i], 0);
+	}
+}
+// same layout as a simulated Mesh state buffer (RG32F)
+void water_read_state(Water_CPU& water, vec2* state)
+{
+	for (uint i = 0; i < water.dimension * water.dimension; i++)
+		state[i] = vec2(water.height[water.current][i], water.velocity[water.current][i]);
+}
+void water_write_state(Water_CPU& water, const vec2* state, const vec4* normals = NULL)
+{
+	// both halves of the ping-pong, dry cells are never written by a step
+	for (uint i = 0; i < water.dimension * water.dimension; i++)
+	{
+		water.height  [0][i] = water.height  [1][i] = state[i].x;
+		water.velocity[0][i] = water.velocity[1][i] = state[i].y;
+		if (normals)
+		{
+			water.normal_x[i] = normals[i].x;
+			water.normal_y[i] = normals[i].y;
+			water.normal_z[i] = normals[i].z;
+		}
+	}
+}
+
+// max absolute difference per component, returns true if all of them are below tolerance
+bool water_compare(Water_CPU& water, const vec2* state, const vec4* normals, float tolerance = 1e-4f)
+{
+	uint D = water.dimension;
+	float max_height = 0, max_velocity = 0, max_normal = 0;
+
+	for (uint i = 0; i < D * D; i++)
+	{
+		max_height   = glm::max(max_height  , glm::abs(water.height  [water.current][i] - state[i].x));
+		max_velocity = glm::max(max_velocity, glm::abs(water.velocity[water.current][i] - state[i].y));
+
+		vec3 normal = vec3(water.normal_x[i], water.normal_y[i], water.normal_z[i]);
+		max_normal = glm::max(max_normal, glm::length(normal - vec3(normals[i])));
+	}
+
+	bool match = max_height <= tolerance && max_velocity <= tolerance && max_normal <= tolerance;
+	print("water cpu/gpu compare (%u^2) : height %g, velocity %g, normal %g -> %s\n",
+		D, max_height, max_velocity, max_normal, match ? "OK" : "MISMATCH");
+
+	return match;
+}
+
+#ifdef __glew_h__
+void water_read_terrain(Water_CPU& water, GLuint terrain_positions)
+{
+	uint D = water.dimension;
+	vec4* positions = Alloc(vec4, D * D);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, terrain_positions);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(vec4) * D * D, positions);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	for (uint i = 0; i < D * D; i++) water.terrain[i] = positions[i].y;
+	free(positions);
+}
+
+// reads a Mesh state buffer back as RG32F
+void read_state_buffer(GLuint buffer, GLenum state_format, vec2* state, uint count)
+{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+
+	if (state_format == GL_RG16F)
+	{
+		uint* packed = Alloc(uint, count);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(uint) * count, packed);
+		for (uint i = 0; i < count; i++) state[i] = glm::unpackHalf2x16(packed[i]);
+		free(packed);
+	}
+	else glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(vec2) * count, state);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// runs one step on both the gpu & the cpu starting from the same state, then compares the results
+// expects the water_sim compute program to be bound with its uniforms & buffers set up
+bool water_compare_gpu(Water_CPU& water, GLuint state_in, GLuint state_out, GLenum state_format, GLuint normals, float dt, float time, float tolerance = 1e-4f)
+{
+	uint D = water.dimension;
+	vec2* gpu_state   = Alloc(vec2, D * D);
+	vec4* gpu_normals = Alloc(vec4, D * D);
+
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	read_state_buffer(state_in, state_format, gpu_state, D * D);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, normals);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(vec4) * D * D, gpu_normals);
+
+	water_write_state(water, gpu_state, gpu_normals);
+	water_step(water, dt, time);
+
+	uint num_groups = (D + WATER_SIM_TILE_SIZE - 1) / WATER_SIM_TILE_SIZE;
+	glDispatchCompute(num_groups, num_groups, 1);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	read_state_buffer(state_out, state_format, gpu_state, D * D);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, normals);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(vec4) * D * D, gpu_normals);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// the cpu keeps full floats, so half state only matches to ~3 digits
+	if (state_format == GL_RG16F) tolerance = glm::max(tolerance, 1e-3f);
+
+	bool match = water_compare(water, gpu_state, gpu_normals, tolerance);
+
+	free(gpu_state);
+	free(gpu_normals);
+	return match;
+}
+#endif
+
+// steps per second for a fully wet grid
+double water_benchmark(uint dimension, uint num_steps = 200, bool use_simd = true, Thread_Pool* pool = NULL, bool huge_pages = false)
+{
+	Water_CPU water = {};
+	init(water, dimension, NULL, pool, huge_pages);
+	water.use_simd = use_simd;
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint i = 0; i < num_steps; i++) water_step(water, 1.f / 60, 1.f);
+	auto end = std::chrono::steady_clock::now();
+
+	double seconds = std::chrono::duration<double>(end - start).count();
+	double steps_per_second = num_steps / seconds;
+	double cells_per_second = steps_per_second * dimension * dimension;
+
+	print("water cpu %s %2u threads (%u^2) : %.1f steps/s, %.1f Mcells/s\n", use_simd ? "simd" : "scalar",
+		pool ? pool->num_threads : 1, dimension, steps_per_second, cells_per_second / 1e6);
+
+	free(water);
+	return cells_per_second;
+}
+
+// cells/s for 1, 2, 4 .. max_threads pinned threads
+void water_benchmark_scaling(uint dimension, uint num_steps = 200, uint max_threads = 0, bool huge_pages = false)
+{
+	if (max_threads == 0) max_threads = num_hardware_threads();
+
+	double single_thread = 0;
+
+	for (uint num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+	{
+		Thread_Pool pool = {};
+		init(&pool, num_threads, true);
+
+		double cells_per_second = water_benchmark(dimension, num_steps, true, &pool, huge_pages);
+		if (num_threads == 1) single_thread = cells_per_second;
+		print("    speedup %.2fx\n", cells_per_second / single_thread);
+
+		shutdown(&pool);
+	}
+}
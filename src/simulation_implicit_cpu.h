@@ -0,0 +1,359 @@
+// implicit integration of the same wave equation as simulation_cpu.h, for steps far past the cfl limit.
+// every step solves (1 - a L) u' = rhs for the new heights with geometric multigrid V-cycles,
+// content/shaders/watermultigrid.comp runs the same cycles on the gpu
+
+enum Water_Integrator
+{
+	WATER_EXPLICIT,        // watersimulation.comp, dt is limited by cfl
+	WATER_BACKWARD_EULER,  // unconditionally stable, damps the high frequencies
+	WATER_CRANK_NICOLSON,  // unconditionally stable, keeps the energy (second order)
+};
+
+// these have to match watermultigrid.comp
+#define WATER_MULTIGRID_MAX_LEVELS       12
+#define WATER_MULTIGRID_MIN_DIMENSION    5     // no coarser grids than this
+#define WATER_MULTIGRID_COARSE_COUPLING  0.05f // stop coarsening once a level is this close to the identity
+#define WATER_MULTIGRID_PRE_SMOOTH       2     // red-black gauss-seidel sweeps on the way down
+#define WATER_MULTIGRID_POST_SMOOTH      2     // & on the way up
+#define WATER_MULTIGRID_COARSE_SMOOTH    8     // sweeps instead of a direct solve on the coarsest level
+#define WATER_MULTIGRID_MAX_CYCLES       16
+#define WATER_MULTIGRID_TOLERANCE        1e-6f // max |residual| / (1 + 4a), the height change one more sweep would make
+
+// theta method : 1 = backward euler, 0.5 = crank-nicolson
+float water_integrator_theta(Water_Integrator integrator)
+{
+	return integrator == WATER_CRANK_NICOLSON ? 0.5f : 1.f;
+}
+
+// coarse cell i sits on fine cell 2i
+uint water_multigrid_coarse_dimension(uint dimension) { return (dimension + 1) / 2; }
+
+// the residual equation is solved on every level but the first, so x & rhs are the error & residual there
+struct Water_Multigrid_Level
+{
+	uint dimension;
+
+	float* x;
+	float* rhs;
+	float* residual;
+	byte*  active; // 1 for cells that are solved for, the rest keep their value (u on the finest level, 0 below)
+};
+
+struct Water_Implicit_CPU
+{
+	Water_Integrator integrator;
+
+	uint num_levels;
+	Water_Multigrid_Level levels[WATER_MULTIGRID_MAX_LEVELS];
+	float* row_residual; // max |residual| per row of the finest level
+
+	// the last solve
+	uint  cycles;
+	float residual;
+};
+
+// a coarse cell is only solved for if every fine cell it covers is. coarse cells over the shore would
+// move the land along with the water, the prolonged correction then fights the smoother & the cycle diverges
+void water_multigrid_coarsen_mask(Water_Multigrid_Level& fine, Water_Multigrid_Level& coarse)
+{
+	uint Df = fine.dimension, Dc = coarse.dimension;
+
+	for (uint y = 1; y + 1 < Dc; y++) {
+	for (uint x = 1; x + 1 < Dc; x++)
+	{
+		byte active = 1;
+		for (int oy = -1; oy <= 1; oy++)
+		for (int ox = -1; ox <= 1; ox++)
+			active &= fine.active[((2 * y + oy) * Df) + (2 * x + ox)];
+
+		coarse.active[(y * Dc) + x] = active;
+	} }
+}
+
+// dimensions of the levels below a grid, returns how many there are
+uint water_multigrid_dimensions(uint dimension, uint* dimensions)
+{
+	uint num_levels = 0;
+	while (num_levels < WATER_MULTIGRID_MAX_LEVELS && dimension >= WATER_MULTIGRID_MIN_DIMENSION)
+	{
+		dimensions[num_levels++] = dimension;
+		dimension = water_multigrid_coarse_dimension(dimension);
+	}
+	return num_levels;
+}
+
+// fills in the masks of every level from the terrain, the same cells the explicit step simulates
+void water_multigrid_masks(Water_Multigrid_Level* levels, uint num_levels, const float* terrain)
+{
+	uint D = levels[0].dimension;
+	for (uint y = 1; y + 1 < D; y++)
+	for (uint x = 1; x + 1 < D; x++)
+		levels[0].active[(y * D) + x] = terrain[(y * D) + x] < 0;
+
+	for (uint l = 1; l < num_levels; l++)
+		water_multigrid_coarsen_mask(levels[l - 1], levels[l]);
+}
+
+void init(Water_Implicit_CPU& implicit, Water_CPU& water, Water_Integrator integrator)
+{
+	implicit.integrator = integrator;
+
+	uint dimensions[WATER_MULTIGRID_MAX_LEVELS];
+	implicit.num_levels = water_multigrid_dimensions(water.dimension, dimensions);
+
+	for (uint l = 0; l < implicit.num_levels; l++)
+	{
+		uint D = dimensions[l];
+		Water_Multigrid_Level& level = implicit.levels[l];
+		level.dimension = D;
+		level.x        = Alloc(float, D * D);
+		level.rhs      = Alloc(float, D * D);
+		level.residual = Alloc(float, D * D);
+		level.active   = Alloc(byte , D * D);
+	}
+
+	water_multigrid_masks(implicit.levels, implicit.num_levels, water.terrain);
+	implicit.row_residual = Alloc(float, water.dimension);
+}
+void free(Water_Implicit_CPU& implicit)
+{
+	for (uint l = 0; l < implicit.num_levels; l++)
+	{
+		free(implicit.levels[l].x);
+		free(implicit.levels[l].rhs);
+		free(implicit.levels[l].residual);
+		free(implicit.levels[l].active);
+	}
+	free(implicit.row_residual);
+	implicit = {};
+}
+
+// one multigrid pass over a level (& the next coarser one for restrict & prolong)
+struct Water_Multigrid_Pass
+{
+	Water_Multigrid_Level* level;
+	Water_Multigrid_Level* coarse;
+	float coupling; // a in (1 + 4a) x - a * (sum of the neighbours) = rhs
+	uint  color;    // red-black sweeps : (x + y) & 1 == color
+	float* row_residual;
+};
+
+// gauss-seidel on one color of row y, the neighbours are all the other color so the rows are independent
+void water_multigrid_smooth_job(uint y, uint thread_index, void* params)
+{
+	Water_Multigrid_Pass* pass = (Water_Multigrid_Pass*)params;
+	Water_Multigrid_Level& level = *pass->level;
+
+	uint  D = level.dimension;
+	float a = pass->coupling;
+	float inv_diagonal = 1.f / (1.f + 4.f * a);
+
+	for (uint x = 1 + ((y + 1 + pass->color) & 1); x + 1 < D; x += 2)
+	{
+		uint i = (y * D) + x;
+		if (!level.active[i]) continue;
+
+		float neighbours = level.x[i - 1] + level.x[i + 1] + level.x[i - D] + level.x[i + D];
+		level.x[i] = (level.rhs[i] + a * neighbours) * inv_diagonal;
+	}
+}
+
+void water_multigrid_residual_job(uint y, uint thread_index, void* params)
+{
+	Water_Multigrid_Pass* pass = (Water_Multigrid_Pass*)params;
+	Water_Multigrid_Level& level = *pass->level;
+
+	uint  D = level.dimension;
+	float a = pass->coupling;
+	float row_max = 0;
+
+	for (uint x = 0; x < D; x++)
+	{
+		uint i = (y * D) + x;
+		float r = 0;
+
+		if (level.active[i])
+		{
+			float neighbours = level.x[i - 1] + level.x[i + 1] + level.x[i - D] + level.x[i + D];
+			r = level.rhs[i] - ((1.f + 4.f * a) * level.x[i] - a * neighbours);
+		}
+
+		level.residual[i] = r;
+		row_max = glm::max(row_max, glm::abs(r));
+	}
+
+	if (pass->row_residual) pass->row_residual[y] = row_max;
+}
+
+// full weighting of the fine residual into the coarse rhs, the coarse error starts at 0
+void water_multigrid_restrict_job(uint y, uint thread_index, void* params)
+{
+	Water_Multigrid_Pass* pass = (Water_Multigrid_Pass*)params;
+	Water_Multigrid_Level& fine   = *pass->level;
+	Water_Multigrid_Level& coarse = *pass->coarse;
+
+	uint Df = fine.dimension, Dc = coarse.dimension;
+
+	for (uint x = 0; x < Dc; x++)
+	{
+		uint i = (y * Dc) + x;
+		float r = 0;
+
+		if (coarse.active[i])
+		{
+			uint center = ((2 * y) * Df) + (2 * x);
+			const float* f = fine.residual;
+
+			r = (4.f *  f[center] +
+			     2.f * (f[center - 1] + f[center + 1] + f[center - Df] + f[center + Df]) +
+			           (f[center - Df - 1] + f[center - Df + 1] + f[center + Df - 1] + f[center + Df + 1])) / 16.f;
+		}
+
+		coarse.rhs[i] = r;
+		coarse.x  [i] = 0;
+	}
+}
+
+// bilinear interpolation of the coarse error onto the fine cells that are solved for
+void water_multigrid_prolong_job(uint y, uint thread_index, void* params)
+{
+	Water_Multigrid_Pass* pass = (Water_Multigrid_Pass*)params;
+	Water_Multigrid_Level& fine   = *pass->level;
+	Water_Multigrid_Level& coarse = *pass->coarse;
+
+	uint Df = fine.dimension, Dc = coarse.dimension;
+	uint y0 = y / 2, y1 = (y + 1) / 2;
+
+	for (uint x = 1; x + 1 < Df; x++)
+	{
+		uint i = (y * Df) + x;
+		if (!fine.active[i]) continue;
+
+		uint x0 = x / 2, x1 = (x + 1) / 2; // the same cell on even x
+		const float* e = coarse.x;
+
+		fine.x[i] += 0.25f * (e[(y0 * Dc) + x0] + e[(y0 * Dc) + x1] + e[(y1 * Dc) + x0] + e[(y1 * Dc) + x1]);
+	}
+}
+
+void water_multigrid_smooth(Water_Implicit_CPU& implicit, Water_CPU& water, uint l, float coupling, uint sweeps)
+{
+	Water_Multigrid_Pass pass = { &implicit.levels[l], NULL, coupling };
+
+	for (uint s = 0; s < sweeps; s++)
+	for (pass.color = 0; pass.color < 2; pass.color++)
+		parallel_for(water.pool, pass.level->dimension - 1, water_multigrid_smooth_job, &pass);
+}
+
+void water_multigrid_v_cycle(Water_Implicit_CPU& implicit, Water_CPU& water, uint l, uint num_levels, float coupling)
+{
+	if (l + 1 == num_levels)
+	{
+		water_multigrid_smooth(implicit, water, l, coupling, WATER_MULTIGRID_COARSE_SMOOTH);
+		return;
+	}
+
+	water_multigrid_smooth(implicit, water, l, coupling, WATER_MULTIGRID_PRE_SMOOTH);
+
+	Water_Multigrid_Pass pass = { &implicit.levels[l], &implicit.levels[l + 1], coupling };
+	parallel_for(water.pool, pass.level->dimension , water_multigrid_residual_job, &pass);
+	parallel_for(water.pool, pass.coarse->dimension, water_multigrid_restrict_job, &pass);
+
+	// twice the spacing on the next level : a / 4
+	water_multigrid_v_cycle(implicit, water, l + 1, num_levels, coupling * 0.25f);
+
+	parallel_for(water.pool, pass.level->dimension - 1, water_multigrid_prolong_job, &pass);
+
+	water_multigrid_smooth(implicit, water, l, coupling, WATER_MULTIGRID_POST_SMOOTH);
+}
+
+// levels below the one where a drops under WATER_MULTIGRID_COARSE_COUPLING would only copy the residual around
+uint water_multigrid_num_levels(uint max_levels, float coupling)
+{
+	uint num_levels = 1;
+	while (num_levels < max_levels && coupling > WATER_MULTIGRID_COARSE_COUPLING)
+	{
+		coupling *= 0.25f;
+		num_levels++;
+	}
+	return num_levels;
+}
+
+// the theta method on u' = v, v' = c^2 L u :
+//   (1 - a L) u1 = u0 + dt v0 + b L u0,  a = theta^2 dt^2 c^2 / h^2,  b = theta (1 - theta) dt^2 c^2 / h^2
+//   v1 = ((u1 - u0) / dt - (1 - theta) v0) / theta
+void water_step_implicit(Water_CPU& water, Water_Implicit_CPU& implicit, float dt, float time)
+{
+	uint D = water.dimension;
+	uint prev = water.current;
+	uint next = prev ^ 1;
+
+	float theta     = water_integrator_theta(implicit.integrator);
+	float stiffness = water_step_params(water, dt).stiffness;
+	float a = theta * theta * dt * dt * stiffness;
+	float b = theta * (1.f - theta) * dt * dt * stiffness;
+
+	const float* u0 = water.height  [prev];
+	const float* v0 = water.velocity[prev];
+
+	Water_Multigrid_Level& finest = implicit.levels[0];
+	for (uint i = 0; i < D * D; i++)
+	{
+		if (finest.active[i])
+		{
+			float laplacian = u0[i - 1] + u0[i + 1] + u0[i - D] + u0[i + D] - 4.f * u0[i];
+			finest.rhs[i] = u0[i] + dt * v0[i] + b * laplacian;
+			finest.x  [i] = u0[i] + dt * v0[i]; // explicit guess
+		}
+		else finest.x[i] = u0[i];
+	}
+
+	uint num_levels = water_multigrid_num_levels(implicit.num_levels, a);
+
+	Water_Multigrid_Pass residual = { &finest, NULL, a, 0, implicit.row_residual };
+	implicit.cycles   = 0;
+	implicit.residual = 0;
+
+	while (implicit.cycles < WATER_MULTIGRID_MAX_CYCLES)
+	{
+		water_multigrid_v_cycle(implicit, water, 0, num_levels, a);
+		implicit.cycles++;
+
+		parallel_for(water.pool, D, water_multigrid_residual_job, &residual);
+
+		// a float residual can't get below ~eps * 4a * |u|, so it is measured in heights
+		implicit.residual = 0;
+		for (uint y = 0; y < D; y++) implicit.residual = glm::max(implicit.residual, implicit.row_residual[y]);
+		implicit.residual /= 1.f + 4.f * a;
+
+		if (implicit.residual <= WATER_MULTIGRID_TOLERANCE) break;
+	}
+
+	// the same per second as the explicit step
+	float attenuation = pow(WATER_ATTENUATION, dt / WATER_TUNED_STEP);
+	float spacing = 2.f / float(D - 1);
+
+	for (uint y = 1; y + 1 < D; y++) {
+	for (uint x = 1; x + 1 < D; x++)
+	{
+		uint i = (y * D) + x;
+		if (!finest.active[i]) continue;
+
+		float* u1 = finest.x;
+		water.height  [next][i] = u1[i];
+		water.velocity[next][i] = attenuation * ((u1[i] - u0[i]) / dt - (1.f - theta) * v0[i]) / theta;
+
+		// from the new heights, the explicit step can only use the old ones
+		float ax = u1[i + 1] - u1[i - 1];
+		float by = u1[i + D] - u1[i - D];
+		float inv_length = 1.f / sqrt(ax * ax + by * by + spacing * spacing);
+
+		water.normal_x[i] = -by * inv_length;
+		water.normal_y[i] = spacing * inv_length;
+		water.normal_z[i] = -ax * inv_length;
+	} }
+
+	water.current ^= 1;
+	water_apply_sponge(water, dt);
+	water_add_ripple(water, time, dt / WATER_TUNED_STEP);
+}
@@ -1,7 +1,9 @@
+#ifdef _WIN32
 #pragma comment(lib, "winmm")
 #pragma comment(lib, "opengl32")
 #pragma comment(lib, "external/GLEW/glew32s")
 #pragma comment(lib, "external/GLFW/glfw3")
+#endif
 
 #define _CRT_SECURE_NO_WARNINGS // because printf is "too dangerous"
 
@@ -11,11 +13,15 @@
 #include "external/stb_image_write.h"
 
 #define GLEW_STATIC
-#include <external/GLEW\glew.h> // OpenGL functions
-#include <external/GLFW\glfw3.h>// window & input
+#include <external/GLEW/glew.h> // OpenGL functions
+#include <external/GLFW/glfw3.h>// window & input
 
+#ifdef _WIN32
 #include <Windows.h>
 #include <fileapi.h>
+#else
+#include <x86intrin.h> // __rdtsc
+#endif
 #include <iostream>
 
 #define out(val) std::cout << ' ' << val << '\n'
@@ -49,6 +55,8 @@ using glm::mat4;
 using glm::ivec2;
 using glm::ivec3;
 
+#include <proprietary/threads.h>
+
 #define BIT_NOISE_1 0xB5297A4D;
 #define BIT_NOISE_2 0x68E31DA4;
 #define BIT_NOISE_3 0x1B56C4E9;
@@ -88,21 +96,6 @@ float perlin(float n)
 
 	return lerp(noise_chance(x1), noise_chance(x2), n - (float)x1);
 }
-byte* read_text_file_into_memory(const char* path)
-{
-	DWORD BytesRead;
-	HANDLE os_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, NULL, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-
-	LARGE_INTEGER size;
-	GetFileSizeEx(os_file, &size);
-
-	byte* memory = (byte*)calloc(size.QuadPart + 1, sizeof(byte));
-	ReadFile(os_file, memory, size.QuadPart, &BytesRead, NULL);
-
-	CloseHandle(os_file);
-
-	return memory;
-}
 
 #define WINDOW_ERROR(str) out("WINDOW ERROR: " << str)
 
@@ -112,8 +105,12 @@ struct Window
 	uint screen_width, screen_height;
 };
 
-void init_window(Window* window, uint screen_width, uint screen_height, const char* window_name = "window")
+// a hidden window renders only into framebuffers of its own, no v-sync & the cursor is left alone. for benchmarks
+// on machines without a display run it under a virtual one with a software gl (xvfb-run & mesa llvmpipe)
+void init_window(Window* window, uint screen_width, uint screen_height, const char* window_name = "window", bool hidden = false)
 {
+	PROFILE_SCOPE("init_window");
+
 	window->screen_width = screen_width;
 	window->screen_height = screen_height;
 
@@ -123,15 +120,16 @@ void init_window(Window* window, uint screen_width, uint screen_height, const ch
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+	glfwWindowHint(GLFW_VISIBLE, hidden ? GL_FALSE : GL_TRUE);
 
 	window->instance = glfwCreateWindow(screen_width, screen_height, window_name, NULL, NULL);
 	if (!window->instance) { glfwTerminate(); WINDOW_ERROR("no window instance"); stop; return; }
 
 	glfwMakeContextCurrent(window->instance);
-	glfwSwapInterval(1); // disable v-sync
+	glfwSwapInterval(hidden ? 0 : 1); // disable v-sync
 
 	//Capture the cursor
-	glfwSetInputMode(window->instance, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	if (!hidden) glfwSetInputMode(window->instance, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 	//GLEW
 	glewExperimental = GL_TRUE;